@@ -13,15 +13,14 @@
 #define __SHREDLINK_POLLER_H
 
 #include <zephyr.h>
+#include <devicetree.h>
 
 /**
- * @TODO: this should be configurable and part of the gamepad API
+ * @brief Number of gamepads exposed to the host, one per enabled
+ * `shredlink,hid-gamepad` devicetree node.
  * 
  */
-struct gamepad{
-    uint32_t buttons;
-    uint8_t axes[3];
-};
+#define GAMEPAD_COUNT	DT_NUM_INST_STATUS_OKAY(shredlink_hid_gamepad)
 
 #ifdef CONFIG_GAMEPAD_DAQ_POLL_MODE
 /**
@@ -30,6 +29,55 @@ struct gamepad{
  */
 void gamepad_polling_process(void);
 
+/**
+ * @brief Stop (or restart) acquisition, e.g. while the host is suspended.
+ * 
+ * Parking takes effect in the acquisition thread, which suspends the gamepad
+ * inputs (or keeps scanning them at a low rate for remote wakeup). After a
+ * restart, every gamepad is reported again even if nothing changed.
+ * Safe to call from an ISR.
+ * 
+ * @param park : true to stop acquisition, false to restart it
+ */
+void gamepad_acquisition_park(bool park);
+
+/**
+ * @brief Timing statistics of acquisition, counted since boot.
+ * 
+ * Every poll period has a read due at its start, which should be done
+ * before the next period starts. Timing is only tracked while polling,
+ * not while waiting for changes.
+ * 
+ */
+struct gamepad_daq_stats{
+	/* Reads performed */
+	uint32_t reads;
+	/* Periods which got no read (see CONFIG_SHREDLINK_DAQ_SKIP) */
+	uint32_t missed;
+	/* Reads started more than CONFIG_SHREDLINK_DAQ_LATE_THRESHOLD_US late */
+	uint32_t late;
+	/* Reads which ended after the end of their period */
+	uint32_t overruns;
+	/* Worst start delay, in microseconds */
+	uint32_t max_start_delay_us;
+};
+
+/**
+ * @brief Get a snapshot of the acquisition timing statistics
+ * 
+ * @param stats : filled with the current statistics
+ */
+void gamepad_daq_stats_get(struct gamepad_daq_stats * stats);
+
+#ifndef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+/**
+ * @brief Workqueue on which acquisition runs. Work submitted to it never
+ * runs concurrently with a read, so it may commit reports in its place.
+ * 
+ */
+struct k_work_q * gamepad_daq_workq(void);
+#endif
+
 #endif
 /**
  * @brief Indicate that a change in tilt has been detected.
@@ -43,4 +91,14 @@ void gamepad_polling_process(void);
  */
 int signal_tilt_event(bool tilt);
 
+#ifdef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+/**
+ * @brief Sample the tilt sensor, and signal a change once the new state
+ * held for CONFIG_SHREDLINK_RTC_TILT_HOLD_TIME_MS. Called by acquisition
+ * on every pass, in place of sensor triggers.
+ * 
+ */
+void tilt_poll(void);
+#endif
+
 #endif
@@ -12,14 +12,52 @@
 #ifndef __SHREDLINK_HID_H
 #define __SHREDLINK_HID_H
 #include <shredlink/daq.h>
+#include <drivers/gamepad.h>
 
 /**
- * @brief Submit a new frame to the queue to be processed
+ * @brief Layout of the reports of a gamepad
+ * 
+ * @param index : gamepad index (devicetree instance number)
+ * @retval NULL if there is no gamepad at `index`
+ */
+const struct gamepad_layout * hid_report_layout(uint8_t index);
+
+/**
+ * @brief Buffer the next report of a gamepad should be decoded into.
+ * 
+ * The same buffer is returned until it is handed over with
+ * hid_report_commit(), so a report which turns out to be unchanged
+ * can simply be overwritten by the next one. Only the acquisition
+ * process may write to it.
+ * 
+ * @param index : gamepad index (devicetree instance number)
+ * @retval NULL if there is no gamepad at `index`
+ */
+uint8_t * hid_report_buffer(uint8_t index);
+
+/**
+ * @brief Hand the report in the buffer of a gamepad over for sending.
+ * The buffer is not copied, and a new one is given out by the next
+ * call to hid_report_buffer().
+ * 
+ * In run to completion mode, the report is written to the endpoint
+ * right away, and the buffer is given out again.
+ * 
+ * @param index : gamepad index (devicetree instance number)
+ * @retval 0 on success
+ * @retval -EINVAL if there is no gamepad at `index`
+ * @retval -EAGAIN in run to completion mode, if the host did not collect
+ * the previous report yet. The report should be committed again later.
+ */
+int hid_report_commit(uint8_t index);
+
+/**
+ * @brief Ask a suspended host to resume, because a gamepad changed.
+ * Does nothing if the host is not suspended.
  * 
- * @param frame : pointer to frame data to be processed
  * @retval 0 on success
  * @retval -errno otherwise
  */
-int submit_frame_data(struct gamepad * frame);
+int hid_request_wakeup(void);
 
-#endif
\ No newline at end of file
+#endif
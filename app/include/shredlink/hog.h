@@ -0,0 +1,41 @@
+/**
+ * @file hog.h
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (C) 2026 Brian Bradley
+ * 
+ * SPDX-License-Identifier: Apache-2.0
+ * 
+ */
+
+#ifndef __SHREDLINK_HOG_H
+#define __SHREDLINK_HOG_H
+
+#include <zephyr.h>
+
+/**
+ * @brief Index of the gamepad which is reported over Bluetooth LE
+ * 
+ */
+#define HOG_GAMEPAD_INDEX	0
+
+/**
+ * @brief Submit the latest packed report of the bluetooth gamepad.
+ * 
+ * Reports are coalesced until the next notification can be sent, but
+ * any button press or release which happened in the meantime is kept
+ * for at least one notification, so that no edge is lost.
+ * 
+ * @param report : report laid out for gamepad `HOG_GAMEPAD_INDEX`
+ */
+void hog_submit_report(const uint8_t * report);
+
+/**
+ * @brief Whether a connected host subscribed to the input report
+ * 
+ * @retval true if reports are notified to a host
+ */
+bool hog_subscribed(void);
+
+#endif
@@ -0,0 +1,227 @@
+/**
+ * @file report.h
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief HID report layout generated from a `shredlink,hid-gamepad` devicetree node.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * The report descriptor, the size of the report and the `struct gamepad_layout`
+ * a gamepad backend decodes into are all derived from the same devicetree node,
+ * so they can not disagree with each other. Every offset and width is a compile
+ * time constant, stored once in flash.
+ *
+ * Layout: buttons first (bit 0 is button 1), then each axis in devicetree order.
+ * Unless `bit-packed` is set, the buttons are padded to a byte boundary and
+ * every axis occupies a full byte. With CONFIG_SHREDLINK_REPORT_TIMESTAMP, a
+ * vendor defined stamp follows the last byte of data (see `struct gamepad_stamp`).
+ */
+
+#ifndef __SHREDLINK_REPORT_H
+#define __SHREDLINK_REPORT_H
+
+#include <zephyr.h>
+#include <devicetree.h>
+#include <sys/util.h>
+#include <sys/byteorder.h>
+#include <usb/class/usb_hid.h>
+#include <drivers/gamepad.h>
+
+#define GAMEPAD_BUTTONS(node_id)		DT_PROP(node_id, buttons)
+#define GAMEPAD_AXES(node_id)			DT_PROP_LEN(node_id, axis_usages)
+#define GAMEPAD_AXIS_BITS(node_id, idx)	DT_PROP_BY_IDX(node_id, axis_bits, idx)
+#define GAMEPAD_BIT_PACKED(node_id)		DT_PROP(node_id, bit_packed)
+
+/* Number of bits a field occupies in the report, including its padding */
+#define GAMEPAD_BTN_FIELD_BITS(node_id) \
+	(GAMEPAD_BIT_PACKED(node_id) ? GAMEPAD_BUTTONS(node_id) : \
+		((GAMEPAD_BUTTONS(node_id) + 7) / 8 * 8))
+#define GAMEPAD_AXIS_FIELD_BITS(node_id, idx) \
+	(GAMEPAD_BIT_PACKED(node_id) ? GAMEPAD_AXIS_BITS(node_id, idx) : 8)
+
+#define GAMEPAD_AXIS_FIELD_SUM(node_id, prop, idx) + GAMEPAD_AXIS_FIELD_BITS(node_id, idx)
+#define GAMEPAD_DATA_BITS(node_id) \
+	(GAMEPAD_BTN_FIELD_BITS(node_id) \
+		DT_FOREACH_PROP_ELEM(node_id, axis_bits, GAMEPAD_AXIS_FIELD_SUM))
+#define GAMEPAD_TAIL_PAD_BITS(node_id)	((8 - (GAMEPAD_DATA_BITS(node_id) % 8)) % 8)
+
+/**
+ * @brief Stamp appended to every report with CONFIG_SHREDLINK_REPORT_TIMESTAMP,
+ * so that the host can tell how long ago the input was sampled. Both fields
+ * are little endian and wrap around.
+ */
+struct gamepad_stamp {
+	/* Time at which the input was sampled, in microseconds */
+	uint32_t sample_us;
+	/* Incremented on every report of the gamepad, gaps are reports which never got out */
+	uint16_t sequence;
+} __packed;
+
+/* Bytes taken by the stamp at the end of every report */
+#define GAMEPAD_STAMP_SIZE \
+	COND_CODE_1(CONFIG_SHREDLINK_REPORT_TIMESTAMP, (sizeof(struct gamepad_stamp)), (0))
+
+/**
+ * @brief Size (in bytes) of the report generated for `node_id`
+ */
+#define GAMEPAD_REPORT_SIZE(node_id) \
+	((GAMEPAD_DATA_BITS(node_id) + 7) / 8 + GAMEPAD_STAMP_SIZE)
+
+/**
+ * @note A Push immediately followed by a Pop leaves the parser state untouched.
+ * They are used to fill the space of a padding item when there is nothing to
+ * pad, so that the descriptor does not need to change length with the layout.
+ */
+#define HID_ITEM_PUSH			0xa4
+#define HID_ITEM_POP			0xb4
+#define HID_ITEM_REPORT_SIZE8	0x75
+#define HID_ITEM_REPORT_COUNT8	0x95
+#define HID_ITEM_INPUT8			0x81
+#define HID_ITEM_USAGE_PAGE16	0x06
+
+#define HID_USAGE_PAGE_VENDOR	0xff00
+#define HID_USAGE_STAMP_TIME	0x01
+#define HID_USAGE_STAMP_SEQ		0x02
+
+/* Vendor defined byte arrays holding `struct gamepad_stamp`, or nothing at all */
+#define GAMEPAD_STAMP_ITEMS \
+	COND_CODE_1(CONFIG_SHREDLINK_REPORT_TIMESTAMP, ( \
+		HID_ITEM_USAGE_PAGE16, HID_USAGE_PAGE_VENDOR & 0xff, HID_USAGE_PAGE_VENDOR >> 8, \
+		HID_LOGICAL_MIN8(0), \
+		HID_LOGICAL_MAX16(0xff, 0x00), \
+		HID_REPORT_SIZE(8), \
+		HID_USAGE(HID_USAGE_STAMP_TIME), \
+		HID_REPORT_COUNT(sizeof(uint32_t)), \
+		/* HID_INPUT (Data,Var,Abs) */ \
+		HID_INPUT(0x02), \
+		HID_USAGE(HID_USAGE_STAMP_SEQ), \
+		HID_REPORT_COUNT(sizeof(uint16_t)), \
+		HID_INPUT(0x02), \
+	), ())
+
+/* Report Size(pad), Report Count(1), Input(Cnst,Ary,Abs) -- or nothing at all */
+#define GAMEPAD_PAD_ITEMS(pad) \
+	((pad) ? HID_ITEM_REPORT_SIZE8 : HID_ITEM_PUSH), ((pad) ? (pad) : HID_ITEM_POP), \
+	((pad) ? HID_ITEM_REPORT_COUNT8 : HID_ITEM_PUSH), ((pad) ? 1 : HID_ITEM_POP), \
+	((pad) ? HID_ITEM_INPUT8 : HID_ITEM_PUSH), ((pad) ? 0x01 : HID_ITEM_POP)
+
+#define GAMEPAD_AXIS_ITEMS(node_id, prop, idx) \
+	HID_USAGE(DT_PROP_BY_IDX(node_id, axis_usages, idx)), \
+	HID_LOGICAL_MAX16(BIT_MASK(GAMEPAD_AXIS_BITS(node_id, idx)) & 0xff, \
+		BIT_MASK(GAMEPAD_AXIS_BITS(node_id, idx)) >> 8), \
+	HID_REPORT_SIZE(GAMEPAD_AXIS_FIELD_BITS(node_id, idx)), \
+	HID_REPORT_COUNT(1), \
+	/* HID_INPUT (Data,Var,Abs) */ \
+	HID_INPUT(0x02),
+
+/**
+ * @brief Body of the HID report descriptor for the gamepad at `node_id`.
+ *
+ * Usage: `static const uint8_t desc[] = { GAMEPAD_HID_REPORT_DESC(node_id) };`
+ */
+#define GAMEPAD_HID_REPORT_DESC(node_id) \
+	HID_USAGE_PAGE(HID_USAGE_GEN_DESKTOP), \
+	HID_USAGE(HID_USAGE_GEN_DESKTOP_GAMEPAD), \
+	HID_COLLECTION(HID_COLLECTION_APPLICATION), \
+	HID_COLLECTION(HID_COLLECTION_PHYSICAL), \
+		/* Bits used for button signalling */ \
+		HID_USAGE_PAGE(HID_USAGE_GEN_BUTTON), \
+		HID_USAGE_MIN8(1), \
+		HID_USAGE_MAX8(GAMEPAD_BUTTONS(node_id)), \
+		HID_LOGICAL_MIN8(0), \
+		HID_LOGICAL_MAX8(1), \
+		HID_REPORT_COUNT(GAMEPAD_BUTTONS(node_id)), \
+		HID_REPORT_SIZE(1), \
+		/* HID_INPUT (Data,Var,Abs) */ \
+		HID_INPUT(0x02), \
+		/* Unused bits up to the first axis */ \
+		GAMEPAD_PAD_ITEMS(GAMEPAD_BTN_FIELD_BITS(node_id) - GAMEPAD_BUTTONS(node_id)), \
+		/* Axes, in devicetree order */ \
+		HID_USAGE_PAGE(HID_USAGE_GEN_DESKTOP), \
+		HID_LOGICAL_MIN8(0), \
+		DT_FOREACH_PROP_ELEM(node_id, axis_usages, GAMEPAD_AXIS_ITEMS) \
+		/* Unused bits up to the end of the report */ \
+		GAMEPAD_PAD_ITEMS(GAMEPAD_TAIL_PAD_BITS(node_id)), \
+		/* Sample time and sequence number, for latency measurements */ \
+		GAMEPAD_STAMP_ITEMS \
+	HID_END_COLLECTION, \
+	HID_END_COLLECTION
+
+/* Bits taken by the axes preceding axis `idx`, one term per possible axis */
+#define GAMEPAD_AXIS_FIELD_BITS_BEFORE(node_id, j, idx) \
+	+ ((j) < (idx) ? COND_CODE_1(DT_PROP_HAS_IDX(node_id, axis_bits, j), \
+		(GAMEPAD_AXIS_FIELD_BITS(node_id, j)), (0)) : 0)
+
+/**
+ * @brief Bit offset of axis `idx` in the report generated for `node_id`
+ */
+#define GAMEPAD_AXIS_OFFSET(node_id, idx) \
+	(GAMEPAD_BTN_FIELD_BITS(node_id) \
+		GAMEPAD_AXIS_FIELD_BITS_BEFORE(node_id, 0, idx) \
+		GAMEPAD_AXIS_FIELD_BITS_BEFORE(node_id, 1, idx) \
+		GAMEPAD_AXIS_FIELD_BITS_BEFORE(node_id, 2, idx) \
+		GAMEPAD_AXIS_FIELD_BITS_BEFORE(node_id, 3, idx) \
+		GAMEPAD_AXIS_FIELD_BITS_BEFORE(node_id, 4, idx) \
+		GAMEPAD_AXIS_FIELD_BITS_BEFORE(node_id, 5, idx) \
+		GAMEPAD_AXIS_FIELD_BITS_BEFORE(node_id, 6, idx))
+
+#define GAMEPAD_AXIS_CHECK(node_id, prop, idx) \
+	BUILD_ASSERT(GAMEPAD_AXIS_BITS(node_id, idx) >= 1 && \
+		GAMEPAD_AXIS_BITS(node_id, idx) <= 8, "axis-bits must be between 1 and 8");
+
+/**
+ * @brief Compile time checks of the properties of the gamepad at `node_id`
+ */
+#define GAMEPAD_LAYOUT_CHECK(node_id) \
+	BUILD_ASSERT(GAMEPAD_BUTTONS(node_id) >= 1 && GAMEPAD_BUTTONS(node_id) <= 32, \
+		"buttons must be between 1 and 32"); \
+	BUILD_ASSERT(DT_PROP_LEN(node_id, axis_usages) == DT_PROP_LEN(node_id, axis_bits), \
+		"axis-usages and axis-bits must have the same length"); \
+	BUILD_ASSERT(GAMEPAD_AXES(node_id) <= GAMEPAD_MAX_AXES, \
+		"more axes declared than struct gamepad_layout can hold"); \
+	DT_FOREACH_PROP_ELEM(node_id, axis_bits, GAMEPAD_AXIS_CHECK)
+
+#define GAMEPAD_AXIS_LAYOUT(node_id, prop, idx) \
+	[idx] = { \
+		.offset = GAMEPAD_AXIS_OFFSET(node_id, idx), \
+		.width = GAMEPAD_AXIS_FIELD_BITS(node_id, idx), \
+		.bits = GAMEPAD_AXIS_BITS(node_id, idx), \
+	},
+
+/**
+ * @brief Initializer of the `struct gamepad_layout` of the gamepad at `node_id`.
+ *
+ * Usage:
+ * @code
+ * GAMEPAD_LAYOUT_CHECK(node_id)
+ * static const struct gamepad_layout layout = GAMEPAD_LAYOUT_INIT(node_id);
+ * @endcode
+ */
+#define GAMEPAD_LAYOUT_INIT(node_id) \
+	{ \
+		.size = GAMEPAD_REPORT_SIZE(node_id), \
+		.buttons = GAMEPAD_BUTTONS(node_id), \
+		.axes = GAMEPAD_AXES(node_id), \
+		.axis = { DT_FOREACH_PROP_ELEM(node_id, axis_bits, GAMEPAD_AXIS_LAYOUT) }, \
+	}
+
+#ifdef CONFIG_SHREDLINK_REPORT_TIMESTAMP
+/**
+ * @brief Write the stamp at the end of a report
+ *
+ * @param layout : layout of the report, as returned by GAMEPAD_LAYOUT_INIT
+ * @param report : report to stamp
+ * @param sample_us : time at which the input was sampled, in microseconds
+ * @param sequence : sequence number of the report
+ */
+static inline void gamepad_report_set_stamp(const struct gamepad_layout * layout,
+	uint8_t * report, uint32_t sample_us, uint16_t sequence){
+	uint8_t * stamp = report + layout->size - GAMEPAD_STAMP_SIZE;
+	sys_put_le32(sample_us, stamp + offsetof(struct gamepad_stamp, sample_us));
+	sys_put_le16(sequence, stamp + offsetof(struct gamepad_stamp, sequence));
+}
+#endif
+
+#endif
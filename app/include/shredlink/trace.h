@@ -0,0 +1,64 @@
+/**
+ * @file trace.h
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#ifndef __SHREDLINK_TRACE_H
+#define __SHREDLINK_TRACE_H
+
+#include <zephyr.h>
+
+#ifdef CONFIG_SHREDLINK_TRACE
+/**
+ * @brief Record a report handed over to the host, if capturing.
+ *
+ * Entries are timestamped with the cycle counter and stored in a RAM
+ * ring, which keeps the most recent CONFIG_SHREDLINK_TRACE_ENTRIES.
+ * Only the acquisition process may call this.
+ *
+ * @param gamepad : gamepad index (devicetree instance number)
+ * @param report : report, laid out for that gamepad
+ * @param size : size of the report
+ */
+void trace_record(uint8_t gamepad, const uint8_t * report, size_t size);
+
+/**
+ * @brief Whether a trace is being replayed. The replay then produces
+ * the reports, and acquisition must not commit any.
+ *
+ */
+bool trace_replaying(void);
+
+/**
+ * @brief Start capturing, discarding the trace held so far
+ *
+ * @retval 0 on success
+ * @retval -EBUSY if replaying
+ */
+int trace_capture_start(void);
+
+void trace_capture_stop(void);
+
+/**
+ * @brief Replay the trace held in RAM through the reporting path.
+ *
+ * @param speed : 1 for the original timing, N to run N times faster,
+ * 0 to hand every report over back to back
+ * @retval 0 on success
+ * @retval -EBUSY if capturing or already replaying
+ * @retval -ENODATA if the trace is empty
+ */
+int trace_replay_start(uint32_t speed);
+
+#else
+static inline void trace_record(uint8_t gamepad, const uint8_t * report, size_t size){}
+static inline bool trace_replaying(void){ return false; }
+#endif /* CONFIG_SHREDLINK_TRACE */
+
+#endif
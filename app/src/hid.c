@@ -2,160 +2,479 @@
  * @file hid.c
  * @author Brian Bradley (brian.bradley.p@gmail.com)
  * @date 2022-02-21
- * 
+ *
  * @copyright Copyright (C) 2022 Brian Bradley
- * 
+ *
  * SPDX-License-Identifier: Apache-2.0
- * 
+ *
  */
+
+#define DT_DRV_COMPAT shredlink_hid_gamepad
+
 #include <zephyr.h>
 #include <device.h>
+#include <init.h>
 #include <logging/log.h>
+#include <shredlink/daq.h>
 #include <shredlink/hid.h>
+#include <shredlink/report.h>
+#include <shredlink/hog.h>
+#include <tracing/tracing_shredlink.h>
 #include <usb/usb_device.h>
 #include <usb/class/usb_hid.h>
 
 LOG_MODULE_DECLARE(shredlink, CONFIG_SHREDLINK_LOG_LEVEL);
 
-#ifdef CONFIG_TILT_SENSOR
-#define BTN_COUNT	10
+BUILD_ASSERT(GAMEPAD_COUNT > 0, "At least one shredlink,hid-gamepad node must be enabled");
+#ifdef CONFIG_SHREDLINK_USB_HID
+BUILD_ASSERT(GAMEPAD_COUNT <= CONFIG_USB_HID_DEVICE_COUNT,
+	"CONFIG_USB_HID_DEVICE_COUNT must provide one HID interface per gamepad");
+#endif
+
+/**
+ * @brief Everything needed to report a single gamepad to the host.
+ *
+ * Each gamepad has its own HID interface (and therefore its own interrupt
+ * endpoint) and its own queue, so a controller which changes state often
+ * never delays the reports of the others.
+ *
+ * Reports are decoded by the gamepad backend straight into one of the
+ * `slots` of the gamepad, and are sent from there. Only slot indices travel
+ * through the queues: `pending` holds the reports waiting to be sent (oldest
+ * first) and `free` the slots which can be decoded into. One slot is always
+ * held by the acquisition process (`current`), and one may be held by the
+ * reporting thread while it writes to the endpoint.
+ *
+ * In run to completion mode, the acquisition process writes the report to
+ * the endpoint itself, so a gamepad only has the slot it decodes into. It
+ * tracks whether the endpoint still holds a report (`busy`), so that it never
+ * writes to a busy endpoint: the USB stack would yield and retry.
+ *
+ */
+struct hid_gamepad{
+	const char * name;
+	const uint8_t * desc;
+	size_t desc_size;
+	const struct gamepad_layout * layout;
+	uint8_t * slots;
+	uint8_t current;
+#ifdef CONFIG_SHREDLINK_USB_HID
+#ifndef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+	struct k_msgq * pending;
+	struct k_msgq * free;
 #else
-#define BTN_COUNT 9
+	atomic_t busy;
+#endif
+	const struct device * hid;
+#endif
+#ifdef CONFIG_SHREDLINK_HID_STATS
+	uint32_t sent;
+	uint32_t dropped;
 #endif
-static const uint8_t hid_report_desc[] = 
-{
-	HID_USAGE_PAGE(HID_USAGE_GEN_DESKTOP),
-	HID_USAGE(HID_USAGE_GEN_DESKTOP_GAMEPAD),
-	HID_COLLECTION(HID_COLLECTION_APPLICATION),
-	HID_COLLECTION(HID_COLLECTION_PHYSICAL),
-			/* Bits used for button signalling */
-			HID_USAGE_PAGE(HID_USAGE_GEN_BUTTON),
-			HID_USAGE_MIN8(1),
-			HID_USAGE_MAX8(BTN_COUNT),
-			HID_LOGICAL_MIN8(0),
-			HID_LOGICAL_MAX8(1),
-			HID_REPORT_COUNT(BTN_COUNT),
-			HID_REPORT_SIZE(1),
-			/* HID_INPUT (Data,Var,Abs) */
-			HID_INPUT(0x02),
-			/* Unused bits */
-			HID_REPORT_SIZE(16 - BTN_COUNT),
-			HID_REPORT_COUNT(1),
-			/* HID_INPUT (Cnst,Ary,Abs) */
-			HID_INPUT(1),
-			/* X and Y axis joystick */
-			HID_USAGE_PAGE(HID_USAGE_GEN_DESKTOP),
-			HID_USAGE(HID_USAGE_GEN_DESKTOP_X),
-			HID_USAGE(HID_USAGE_GEN_DESKTOP_Y),
-			HID_LOGICAL_MIN8(0),
-			HID_LOGICAL_MAX8(63),
-			HID_REPORT_SIZE(8),
-			HID_REPORT_COUNT(2),
-			/* HID_INPUT (Data,Var,Abs) */
-			HID_INPUT(0x02),
-			/* whammy bar */
-			HID_USAGE_PAGE(HID_USAGE_GEN_DESKTOP),
-            /* Slider object. May be a more appropriate usage */
-			HID_USAGE(0x36),
-			HID_LOGICAL_MIN8(0),
-			HID_LOGICAL_MAX8(31),
-			HID_REPORT_SIZE(8),
-			HID_REPORT_COUNT(1),
-			/* HID_INPUT (Data,Var,Abs) */
-			HID_INPUT(0x02),
-		HID_END_COLLECTION,
-	HID_END_COLLECTION,
 };
 
+#if defined(CONFIG_SHREDLINK_USB_HID) && !defined(CONFIG_SHREDLINK_RUN_TO_COMPLETION)
+#define HID_REPORT_SLOTS	(CONFIG_SHREDLINK_HID_QUEUE_DEPTH + 2)
+#define GAMEPAD_USB_DEFINE(inst) \
+	K_MSGQ_DEFINE(hid_pending_##inst, sizeof(uint8_t), CONFIG_SHREDLINK_HID_QUEUE_DEPTH, 1); \
+	K_MSGQ_DEFINE(hid_free_##inst, sizeof(uint8_t), HID_REPORT_SLOTS, 1);
+#define GAMEPAD_USB_ENTRY(inst) \
+	.pending = &hid_pending_##inst, \
+	.free = &hid_free_##inst,
+#else
+/* Without a queue, the report is handed over (or written) before the next one is decoded */
+#define HID_REPORT_SLOTS	1
+#define GAMEPAD_USB_DEFINE(inst)
+#define GAMEPAD_USB_ENTRY(inst)
+#endif
+
+#define GAMEPAD_HID_DEFINE(inst) \
+	GAMEPAD_LAYOUT_CHECK(DT_DRV_INST(inst)) \
+	static const uint8_t hid_report_desc_##inst[] = { \
+		GAMEPAD_HID_REPORT_DESC(DT_DRV_INST(inst)) \
+	}; \
+	static const struct gamepad_layout hid_layout_##inst = \
+		GAMEPAD_LAYOUT_INIT(DT_DRV_INST(inst)); \
+	static uint8_t hid_slots_##inst[HID_REPORT_SLOTS][GAMEPAD_REPORT_SIZE(DT_DRV_INST(inst))]; \
+	GAMEPAD_USB_DEFINE(inst)
+
+DT_INST_FOREACH_STATUS_OKAY(GAMEPAD_HID_DEFINE)
+
+#define GAMEPAD_HID_ENTRY(inst) \
+	[inst] = { \
+		.name = "HID_" STRINGIFY(inst), \
+		.desc = hid_report_desc_##inst, \
+		.desc_size = sizeof(hid_report_desc_##inst), \
+		.layout = &hid_layout_##inst, \
+		.slots = &hid_slots_##inst[0][0], \
+		.current = 0, \
+		GAMEPAD_USB_ENTRY(inst) \
+	},
+
+static struct hid_gamepad gamepads[GAMEPAD_COUNT] = {
+	DT_INST_FOREACH_STATUS_OKAY(GAMEPAD_HID_ENTRY)
+};
+
+static inline uint8_t * slot_buffer(const struct hid_gamepad * gp, uint8_t slot){
+	return gp->slots + slot * gp->layout->size;
+}
+
+const struct gamepad_layout * hid_report_layout(uint8_t index){
+	if (index >= GAMEPAD_COUNT){
+		return NULL;
+	}
+	return gamepads[index].layout;
+}
+
+uint8_t * hid_report_buffer(uint8_t index){
+	if (index >= GAMEPAD_COUNT){
+		return NULL;
+	}
+	return slot_buffer(&gamepads[index], gamepads[index].current);
+}
+
+#ifdef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+static int write_report(struct hid_gamepad * gp, const uint8_t * report);
+
 /**
- * @brief Pack the hid report so that it can be sent raw
- * rather than packing into a coniguous array manually.
- * 
+ * @brief The host collected the report held by the endpoint of `dev`
+ *
  */
-struct __attribute__((packed)) hid_report{
-	uint16_t buttons;
-	uint8_t axes[2];
-	uint8_t whammy;
-};
+static void int_in_ready(const struct device * dev){
+	for (int i = 0; i < GAMEPAD_COUNT; i++){
+		if (gamepads[i].hid == dev){
+			atomic_clear(&gamepads[i].busy);
+		}
+	}
+}
 
-K_MSGQ_DEFINE(hid_msgq, sizeof(struct hid_report), 5, 4);
+static const struct hid_ops hid_ops = {
+	.int_in_ready = int_in_ready,
+};
+#define HID_OPS		(&hid_ops)
 
 /**
- * @brief Packs gamepad data into the prepared hid report format
- * 
- * @param rpt : pointer to hid report to fill
- * @param data : pointer to data frame with which to fill the report
- * @retval -ENODEV on rpt or data NULL
- * @retval 0 on success
+ * @brief Forget reports held by the endpoints, which the controller
+ * drops on reset and disconnection
+ *
  */
-static int fill_hid_report(struct hid_report * rpt, struct gamepad * data){
-	if (rpt == NULL || data == NULL){
-		return -ENODEV;
-	}
-	rpt->axes[0] = data->axes[0];
-	rpt->axes[1] = data->axes[1];
-	rpt->whammy = data->axes[2];
-	rpt->buttons = data->buttons;
-	return 0;
+static void endpoints_reset(void){
+	for (int i = 0; i < GAMEPAD_COUNT; i++){
+		atomic_clear(&gamepads[i].busy);
+	}
 }
+#else
+#define HID_OPS		NULL
+#endif
 
-int submit_frame_data(struct gamepad * frame){
-    struct hid_report report;
-    int ret = fill_hid_report(&report, frame);
-    if (ret == 0){
-            while ((ret = k_msgq_put(&hid_msgq, &report, K_NO_WAIT)) != 0) {
-            /* message queue is full: purge old data & try again */
-            k_msgq_purge(&hid_msgq);
-        }
-    }
-    return ret;
+int hid_report_commit(uint8_t index){
+	if (index >= GAMEPAD_COUNT){
+		return -EINVAL;
+	}
+	struct hid_gamepad * gp = &gamepads[index];
+#ifdef CONFIG_SHREDLINK_TRACEPOINTS
+	/* Reports recycled to make room for this one */
+	int dropped = 0;
+#endif
+	SHREDLINK_TRACEPOINT_ENTER(QUEUE, index);
+#ifdef CONFIG_SHREDLINK_BLE_HOG
+	if (index == HOG_GAMEPAD_INDEX){
+		hog_submit_report(slot_buffer(gp, gp->current));
+	}
+#endif
+#if defined(CONFIG_SHREDLINK_RUN_TO_COMPLETION)
+	/* The endpoint buffer takes a copy, the slot can be decoded into right away */
+	int ret = write_report(gp, slot_buffer(gp, gp->current));
+	if (ret != 0){
+		SHREDLINK_TRACEPOINT_EXIT(QUEUE, dropped);
+		return ret;
+	}
+#elif defined(CONFIG_SHREDLINK_USB_HID)
+	while (k_msgq_put(gp->pending, &gp->current, K_NO_WAIT) != 0) {
+		/* queue is full: recycle the oldest report & try again */
+		uint8_t oldest;
+		if (k_msgq_get(gp->pending, &oldest, K_NO_WAIT) == 0){
+			k_msgq_put(gp->free, &oldest, K_NO_WAIT);
+#ifdef CONFIG_SHREDLINK_TRACEPOINTS
+			dropped++;
+#endif
+#ifdef CONFIG_SHREDLINK_HID_STATS
+			gp->dropped++;
+#endif
+		}
+	}
+	/* With at most QUEUE_DEPTH slots pending and one being sent, there is always one free */
+	int ret = k_msgq_get(gp->free, &gp->current, K_NO_WAIT);
+	__ASSERT(ret == 0, "no free report slot");
+	(void)ret;
+#endif
+	SHREDLINK_TRACEPOINT_EXIT(QUEUE, dropped);
+	return 0;
 }
 
+#ifdef CONFIG_SHREDLINK_USB_HID
+
 static enum usb_dc_status_code usb_status;
+/* Cycle count of the last resume (or configuration), until a report goes out */
+static uint32_t resume_cycles;
+static bool resume_pending;
+/* Boot milestones not logged yet */
+static bool boot_enumeration_pending = true;
+static bool boot_report_pending = true;
+
+/**
+ * @brief Time since the kernel started, for boot milestones
+ *
+ */
+static inline uint32_t boot_time_us(void){
+	return (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+/**
+ * @brief Give the slots of every report waiting to be sent back.
+ * The host will not read them, and they are stale once it comes back.
+ *
+ */
+static void discard_pending_reports(void){
+#ifndef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+	for (int i = 0; i < GAMEPAD_COUNT; i++){
+		struct hid_gamepad * gp = &gamepads[i];
+		uint8_t slot;
+		while (k_msgq_get(gp->pending, &slot, K_NO_WAIT) == 0){
+			k_msgq_put(gp->free, &slot, K_NO_WAIT);
+		}
+	}
+#endif
+}
+
 static void status_cb(enum usb_dc_status_code status, const uint8_t *param)
 {
 	usb_status = status;
+	switch (status){
+#ifdef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+	case USB_DC_RESET:
+		endpoints_reset();
+		break;
+#endif
+	case USB_DC_SUSPEND:
+	case USB_DC_DISCONNECTED:
+#ifdef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+		if (status == USB_DC_DISCONNECTED){
+			endpoints_reset();
+		}
+#endif
+		discard_pending_reports();
+#ifdef CONFIG_SHREDLINK_USB_SUSPEND_PARK
+		gamepad_acquisition_park(true);
+#endif
+		break;
+	case USB_DC_CONFIGURED:
+		if (boot_enumeration_pending){
+			boot_enumeration_pending = false;
+			LOG_INF("boot: enumerated at %u us", boot_time_us());
+		}
+		/* fallthrough */
+	case USB_DC_RESUME:
+		resume_cycles = k_cycle_get_32();
+		resume_pending = true;
+#ifdef CONFIG_SHREDLINK_USB_SUSPEND_PARK
+		gamepad_acquisition_park(false);
+#endif
+		break;
+	default:
+		break;
+	}
 }
 
-void hid_process(void){
-    const struct device *hid;
-	int ret;
-    hid = device_get_binding("HID_0");
-	if (hid == NULL) {
-		LOG_ERR("Cannot get USB HID Device");
-		return;
+int hid_request_wakeup(void){
+	if (usb_status != USB_DC_SUSPEND){
+		return 0;
 	}
-	usb_hid_register_device(hid,
-				hid_report_desc, sizeof(hid_report_desc),
-				NULL);
+#ifdef CONFIG_USB_DEVICE_REMOTE_WAKEUP
+	int ret = usb_wakeup_request();
+	if (ret != 0){
+		LOG_WRN("remote wakeup refused: %d", ret);
+	}
+	return ret;
+#else
+	return -ENOTSUP;
+#endif
+}
 
-	usb_hid_init(hid);
+/**
+ * @brief Fill the free queue of every gamepad with every slot but the
+ * one held by the acquisition process, register the HID interfaces and
+ * enable USB.
+ *
+ * This runs as soon as the drivers are initialized, rather than when the
+ * reporting thread gets scheduled, so that the host can enumerate the
+ * adapter while the controllers are still being discovered.
+ *
+ */
+static int hid_usb_init(const struct device * dev){
+	ARG_UNUSED(dev);
+	for (int i = 0; i < GAMEPAD_COUNT; i++){
+		struct hid_gamepad * gp = &gamepads[i];
+#ifndef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+		for (uint8_t slot = 0; slot < HID_REPORT_SLOTS; slot++){
+			if (slot != gp->current){
+				k_msgq_put(gp->free, &slot, K_NO_WAIT);
+			}
+		}
+#endif
+		gp->hid = device_get_binding(gp->name);
+		if (gp->hid == NULL) {
+			LOG_ERR("Cannot get USB HID Device %s", gp->name);
+			return -ENODEV;
+		}
+		usb_hid_register_device(gp->hid,
+					gp->desc, gp->desc_size,
+					HID_OPS);
 
-	ret = usb_enable(status_cb);
+		usb_hid_init(gp->hid);
+	}
+	int ret = usb_enable(status_cb);
 	if (ret != 0) {
 		LOG_ERR("Failed to enable USB");
-		return;
-	}
-	struct hid_report last_report = {0};
-    while(1){
-        /* Grab the latest report when it is available,
-        and send it if the data is new */
-        struct hid_report report = {0};
-        if (k_msgq_get(&hid_msgq, &report, K_FOREVER) == 0)
-		{
-            /* Check if the report is new */
-            if (memcmp(&report, &last_report, sizeof(struct hid_report)) != 0){
-				/* Data doesn't match. Immediately send an update to the host. */
-				ret = hid_int_ep_write(hid, (const uint8_t *)&report, sizeof(report), NULL);
-				if (ret) {
-					LOG_ERR("HID write error, %d", ret);
+		return ret;
+	}
+	LOG_INF("boot: USB enabled at %u us", boot_time_us());
+	return 0;
+}
+
+SYS_INIT(hid_usb_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+/**
+ * @brief Write a report to the interrupt endpoint of a gamepad.
+ *
+ * Only reports in which something changed are committed, so there is
+ * no need to compare against the previous one.
+ *
+ * @param gp : gamepad the report belongs to
+ * @param report : report to write
+ * @retval 0 on success
+ * @retval -EAGAIN if the host did not collect the previous report yet
+ * @retval -errno otherwise
+ */
+static int write_report(struct hid_gamepad * gp, const uint8_t * report){
+	SHREDLINK_TRACEPOINT_ENTER(EP_WRITE, gp->current);
+#ifdef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+	/* usb_write() would log, yield and retry on a busy endpoint */
+	if (atomic_set(&gp->busy, 1)){
+		SHREDLINK_TRACEPOINT_EXIT(EP_WRITE, -EAGAIN);
+		return -EAGAIN;
+	}
+#endif
+	int ret = hid_int_ep_write(gp->hid, report, gp->layout->size, NULL);
+#ifdef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+	if (ret != 0){
+		atomic_clear(&gp->busy);
+	}
+#endif
+	SHREDLINK_TRACEPOINT_EXIT(EP_WRITE, ret);
+	if (ret) {
+		if (!IS_ENABLED(CONFIG_SHREDLINK_RUN_TO_COMPLETION) || ret != -EAGAIN){
+			LOG_ERR("%s write error, %d", gp->name, ret);
+		}
+	}
+	else {
+#ifdef CONFIG_SHREDLINK_HID_STATS
+		gp->sent++;
+#endif
+		if (boot_report_pending){
+			boot_report_pending = false;
+			LOG_INF("boot: first report at %u us", boot_time_us());
+		}
+		if (resume_pending){
+			resume_pending = false;
+			LOG_INF("first report %u us after resume or configuration",
+				k_cyc_to_us_floor32(k_cycle_get_32() - resume_cycles));
+		}
+	}
+	return ret;
+}
+
+#ifndef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+/**
+ * @brief Send a pending report to the host, then give its slot back.
+ *
+ * @param gp : gamepad the report belongs to
+ * @param slot : slot holding the report
+ */
+static void send_report(struct hid_gamepad * gp, uint8_t slot){
+	write_report(gp, slot_buffer(gp, slot));
+	k_msgq_put(gp->free, &slot, K_NO_WAIT);
+}
+
+#ifdef CONFIG_SHREDLINK_HID_STATS
+/**
+ * @brief Log the report rate of every gamepad since the last call
+ *
+ * @param elapsed_ms : time since the last call
+ */
+static void log_hid_stats(int64_t elapsed_ms){
+	for (int i = 0; i < GAMEPAD_COUNT; i++){
+		struct hid_gamepad * gp = &gamepads[i];
+		LOG_INF("%s: %u reports/s, %u dropped", gp->name,
+			(uint32_t)(gp->sent * MSEC_PER_SEC / elapsed_ms), gp->dropped);
+		gp->sent = 0;
+		gp->dropped = 0;
+	}
+}
+#endif
+
+void hid_process(void){
+	struct k_poll_event events[GAMEPAD_COUNT];
+	for (int i = 0; i < GAMEPAD_COUNT; i++){
+		struct hid_gamepad * gp = &gamepads[i];
+		if (gp->hid == NULL) {
+			/* USB could not be set up, see hid_usb_init() */
+			return;
+		}
+		k_poll_event_init(&events[i],
+				K_POLL_TYPE_MSGQ_DATA_AVAILABLE,
+				K_POLL_MODE_NOTIFY_ONLY,
+				gp->pending);
+	}
+#ifdef CONFIG_SHREDLINK_HID_STATS
+	int64_t stats_start = k_uptime_get();
+	const k_timeout_t timeout = K_MSEC(CONFIG_SHREDLINK_HID_STATS_INTERVAL_MS);
+#else
+	const k_timeout_t timeout = K_FOREVER;
+#endif
+	while(1){
+		/* Wait for any gamepad to have a report available */
+		k_poll(events, GAMEPAD_COUNT, timeout);
+		for (int i = 0; i < GAMEPAD_COUNT; i++){
+			events[i].state = K_POLL_STATE_NOT_READY;
+		}
+		/* Take one report from each gamepad in turn, so that a busy
+		controller can not hold the others back */
+		bool pending;
+		do {
+			pending = false;
+			for (int i = 0; i < GAMEPAD_COUNT; i++){
+				uint8_t slot;
+				SHREDLINK_TRACEPOINT_ENTER(HID_DEQUEUE, i);
+				int rc = k_msgq_get(gamepads[i].pending, &slot, K_NO_WAIT);
+				SHREDLINK_TRACEPOINT_EXIT(HID_DEQUEUE, rc == 0 ? slot : rc);
+				if (rc == 0){
+					send_report(&gamepads[i], slot);
+					pending = true;
 				}
-                /* Update the latest data */
-			    memcpy(&last_report, &report, sizeof(struct hid_report));
 			}
-        }
-    }
+		} while (pending);
+#ifdef CONFIG_SHREDLINK_HID_STATS
+		int64_t elapsed = k_uptime_get() - stats_start;
+		if (elapsed >= CONFIG_SHREDLINK_HID_STATS_INTERVAL_MS){
+			log_hid_stats(elapsed);
+			stats_start += elapsed;
+		}
+#endif
+	}
 }
 
-K_THREAD_DEFINE(hid_reporting, CONFIG_SHREDLINK_HID_STACKSIZE, hid_process, 
+K_THREAD_DEFINE(hid_reporting, CONFIG_SHREDLINK_HID_STACKSIZE, hid_process,
 	NULL, NULL, NULL, CONFIG_SHREDLINK_HID_PRIORITY, 0, 0);
+#endif /* !CONFIG_SHREDLINK_RUN_TO_COMPLETION */
+#endif /* CONFIG_SHREDLINK_USB_HID */
@@ -0,0 +1,475 @@
+/**
+ * @file hog.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Report the gamepad over Bluetooth LE using the HID over GATT profile.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+#include <zephyr.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+#include <settings/settings.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/gatt.h>
+#include <bluetooth/uuid.h>
+#include <shredlink/hog.h>
+#include <shredlink/report.h>
+
+LOG_MODULE_DECLARE(shredlink, CONFIG_SHREDLINK_LOG_LEVEL);
+
+#define HOG_NODE		DT_INST(HOG_GAMEPAD_INDEX, shredlink_hid_gamepad)
+#define HOG_REPORT_SIZE	GAMEPAD_REPORT_SIZE(HOG_NODE)
+/* Buttons always start the report, so they are held in its first bytes */
+#define HOG_BTN_BYTES	((GAMEPAD_BUTTONS(HOG_NODE) + 7) / 8)
+
+/* Shortest interval allowed by the specification (7.5 ms), in 1.25 ms units */
+#define HOG_CONN_INTERVAL	6
+#define HOG_CONN_TIMEOUT	400
+
+#ifdef CONFIG_BT_SMP
+#define HOG_PERM_READ	BT_GATT_PERM_READ_ENCRYPT
+#define HOG_PERM_WRITE	BT_GATT_PERM_WRITE_ENCRYPT
+#else
+#define HOG_PERM_READ	BT_GATT_PERM_READ
+#define HOG_PERM_WRITE	BT_GATT_PERM_WRITE
+#endif
+
+enum {
+	HIDS_REMOTE_WAKE = BIT(0),
+	HIDS_NORMALLY_CONNECTABLE = BIT(1),
+};
+
+enum {
+	HIDS_INPUT = 0x01,
+	HIDS_OUTPUT = 0x02,
+	HIDS_FEATURE = 0x03,
+};
+
+struct hids_info {
+	uint16_t version; /* version number of base USB HID Specification */
+	uint8_t code; /* country HID Device hardware is localized for. */
+	uint8_t flags;
+} __packed;
+
+struct hids_report {
+	uint8_t id; /* report id */
+	uint8_t type; /* report type */
+} __packed;
+
+static const uint8_t report_map[] = {
+	GAMEPAD_HID_REPORT_DESC(HOG_NODE)
+};
+
+static const struct hids_info info = {
+	.version = sys_cpu_to_le16(0x0111),
+	.code = 0x00,
+	.flags = HIDS_NORMALLY_CONNECTABLE,
+};
+
+/* The report map does not use report IDs */
+static const struct hids_report input = {
+	.id = 0x00,
+	.type = HIDS_INPUT,
+};
+
+static uint8_t ctrl_point;
+
+/**
+ * @brief State shared between the acquisition path, which submits
+ * reports, and the bluetooth stack, which sends them.
+ *
+ */
+static struct {
+	struct k_spinlock lock;
+	/* Latest report submitted */
+	uint8_t latest[HOG_REPORT_SIZE];
+	/* Last report notified to the host */
+	uint8_t sent[HOG_REPORT_SIZE];
+	/* Button edges since the last notification, which must not be lost */
+	uint8_t pressed[HOG_BTN_BYTES];
+	uint8_t released[HOG_BTN_BYTES];
+	/* Cycle count of the oldest change not yet notified */
+	uint32_t changed_at;
+	bool pending;
+	bool in_flight;
+	bool notify;
+	struct bt_conn * conn;
+} hog;
+
+K_SEM_DEFINE(hog_sem, 0, 1);
+
+#ifdef CONFIG_SHREDLINK_BLE_HOG_STATS
+static struct {
+	uint32_t count;
+	uint64_t latency_sum;
+	uint32_t latency_min;
+	uint32_t latency_max;
+	int64_t start;
+} hog_stats = {
+	.latency_min = UINT32_MAX,
+};
+#endif
+
+static ssize_t read_info(struct bt_conn *conn,
+			  const struct bt_gatt_attr *attr, void *buf,
+			  uint16_t len, uint16_t offset)
+{
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, attr->user_data,
+				 sizeof(struct hids_info));
+}
+
+static ssize_t read_report_map(struct bt_conn *conn,
+			       const struct bt_gatt_attr *attr, void *buf,
+			       uint16_t len, uint16_t offset)
+{
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, report_map,
+				 sizeof(report_map));
+}
+
+static ssize_t read_report(struct bt_conn *conn,
+			   const struct bt_gatt_attr *attr, void *buf,
+			   uint16_t len, uint16_t offset)
+{
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, attr->user_data,
+				 sizeof(struct hids_report));
+}
+
+static ssize_t read_input_report(struct bt_conn *conn,
+				 const struct bt_gatt_attr *attr, void *buf,
+				 uint16_t len, uint16_t offset)
+{
+	uint8_t report[HOG_REPORT_SIZE];
+	k_spinlock_key_t key = k_spin_lock(&hog.lock);
+	memcpy(report, hog.latest, sizeof(report));
+	k_spin_unlock(&hog.lock, key);
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, report, sizeof(report));
+}
+
+bool hog_subscribed(void){
+	k_spinlock_key_t key = k_spin_lock(&hog.lock);
+	bool subscribed = hog.notify && hog.conn != NULL;
+	k_spin_unlock(&hog.lock, key);
+	return subscribed;
+}
+
+static void input_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	k_spinlock_key_t key = k_spin_lock(&hog.lock);
+	hog.notify = (value == BT_GATT_CCC_NOTIFY);
+	k_spin_unlock(&hog.lock, key);
+	/* Send the current state as soon as the host subscribes */
+	k_sem_give(&hog_sem);
+}
+
+static ssize_t write_ctrl_point(struct bt_conn *conn,
+				const struct bt_gatt_attr *attr,
+				const void *buf, uint16_t len, uint16_t offset,
+				uint8_t flags)
+{
+	uint8_t *value = attr->user_data;
+
+	if (offset + len > sizeof(ctrl_point)) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+	memcpy(value + offset, buf, len);
+	return len;
+}
+
+/* HID Service Declaration */
+BT_GATT_SERVICE_DEFINE(hog_svc,
+	BT_GATT_PRIMARY_SERVICE(BT_UUID_HIDS),
+	BT_GATT_CHARACTERISTIC(BT_UUID_HIDS_INFO, BT_GATT_CHRC_READ,
+			       BT_GATT_PERM_READ, read_info, NULL, (void *)&info),
+	BT_GATT_CHARACTERISTIC(BT_UUID_HIDS_REPORT_MAP, BT_GATT_CHRC_READ,
+			       BT_GATT_PERM_READ, read_report_map, NULL, NULL),
+	BT_GATT_CHARACTERISTIC(BT_UUID_HIDS_REPORT,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+			       HOG_PERM_READ, read_input_report, NULL, NULL),
+	BT_GATT_CCC(input_ccc_changed, HOG_PERM_READ | HOG_PERM_WRITE),
+	BT_GATT_DESCRIPTOR(BT_UUID_HIDS_REPORT_REF, BT_GATT_PERM_READ,
+			   read_report, NULL, (void *)&input),
+	BT_GATT_CHARACTERISTIC(BT_UUID_HIDS_CTRL_POINT,
+			       BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+			       BT_GATT_PERM_WRITE, NULL, write_ctrl_point, &ctrl_point),
+);
+
+/* Input report characteristic declaration in `hog_svc` */
+#define HOG_REPORT_ATTR	(&hog_svc.attrs[5])
+
+static const struct bt_data ad[] = {
+	/* Appearance: gamepad (0x03c4) */
+	BT_DATA_BYTES(BT_DATA_GAP_APPEARANCE, 0xc4, 0x03),
+	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+	BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_16_ENCODE(BT_UUID_HIDS_VAL)),
+};
+
+/**
+ * @brief Mask of the button bits held in byte `i` of the report
+ *
+ */
+static inline uint8_t button_mask(size_t i){
+	size_t bits = GAMEPAD_BUTTONS(HOG_NODE) - i * 8;
+	return bits >= 8 ? 0xff : BIT_MASK(bits);
+}
+
+void hog_submit_report(const uint8_t * report){
+	k_spinlock_key_t key = k_spin_lock(&hog.lock);
+	if (memcmp(report, hog.latest, HOG_REPORT_SIZE) == 0){
+		k_spin_unlock(&hog.lock, key);
+		return;
+	}
+	/* Remember every edge relative to what the host last saw, so
+	a press and release between two notifications still reaches it */
+	for (size_t i = 0; i < HOG_BTN_BYTES; i++){
+		uint8_t mask = button_mask(i);
+		hog.pressed[i] |= report[i] & ~hog.sent[i] & mask;
+		hog.released[i] |= ~report[i] & hog.sent[i] & mask;
+	}
+	memcpy(hog.latest, report, HOG_REPORT_SIZE);
+	if (!hog.pending){
+		hog.changed_at = k_cycle_get_32();
+		hog.pending = true;
+	}
+	k_spin_unlock(&hog.lock, key);
+	k_sem_give(&hog_sem);
+}
+
+#ifdef CONFIG_SHREDLINK_BLE_HOG_STATS
+/**
+ * @brief Account for a notification which has just been sent and
+ * periodically log the notification rate and latency.
+ *
+ * @param changed_at : cycle count of the oldest change it carried
+ */
+static void update_hog_stats(uint32_t changed_at){
+	uint32_t latency = k_cyc_to_us_floor32(k_cycle_get_32() - changed_at);
+	hog_stats.count++;
+	hog_stats.latency_sum += latency;
+	hog_stats.latency_min = MIN(hog_stats.latency_min, latency);
+	hog_stats.latency_max = MAX(hog_stats.latency_max, latency);
+
+	int64_t elapsed = k_uptime_get() - hog_stats.start;
+	if (elapsed >= CONFIG_SHREDLINK_BLE_HOG_STATS_INTERVAL_MS){
+		LOG_INF("hog: %u notifications/s, latency min %u avg %u max %u us",
+			(uint32_t)(hog_stats.count * MSEC_PER_SEC / elapsed),
+			hog_stats.latency_min,
+			(uint32_t)(hog_stats.latency_sum / hog_stats.count),
+			hog_stats.latency_max);
+		hog_stats.count = 0;
+		hog_stats.latency_sum = 0;
+		hog_stats.latency_min = UINT32_MAX;
+		hog_stats.latency_max = 0;
+		hog_stats.start += elapsed;
+	}
+}
+#endif
+
+/**
+ * @brief Called once a notification has been handed to the controller.
+ * Only one notification is in flight at a time, so any changes which
+ * accumulated meanwhile are merged into the next one.
+ *
+ */
+static void notify_sent(struct bt_conn *conn, void *user_data)
+{
+	k_spinlock_key_t key = k_spin_lock(&hog.lock);
+	hog.in_flight = false;
+	k_spin_unlock(&hog.lock, key);
+#ifdef CONFIG_SHREDLINK_BLE_HOG_STATS
+	update_hog_stats((uint32_t)(uintptr_t)user_data);
+#endif
+	k_sem_give(&hog_sem);
+}
+
+/**
+ * @brief Notify the host of the latest state, merged with any button edges
+ * it has not seen yet, unless a notification is already in flight.
+ *
+ */
+static void hog_send_pending(void){
+	uint8_t report[HOG_REPORT_SIZE];
+	k_spinlock_key_t key = k_spin_lock(&hog.lock);
+	if (hog.in_flight || !hog.notify || hog.conn == NULL){
+		k_spin_unlock(&hog.lock, key);
+		return;
+	}
+	memcpy(report, hog.latest, sizeof(report));
+	for (size_t i = 0; i < HOG_BTN_BYTES; i++){
+		report[i] = (report[i] | hog.pressed[i]) & ~hog.released[i];
+		hog.pressed[i] = 0;
+		hog.released[i] = 0;
+	}
+	if (memcmp(report, hog.sent, sizeof(report)) == 0){
+		hog.pending = false;
+		k_spin_unlock(&hog.lock, key);
+		return;
+	}
+	memcpy(hog.sent, report, sizeof(report));
+	uint32_t changed_at = hog.changed_at;
+	/* Anything which changes from now on belongs to the next notification */
+	hog.pending = false;
+	hog.in_flight = true;
+	struct bt_conn * conn = bt_conn_ref(hog.conn);
+	k_spin_unlock(&hog.lock, key);
+
+	struct bt_gatt_notify_params params = {
+		.attr = HOG_REPORT_ATTR,
+		.data = report,
+		.len = sizeof(report),
+		.func = notify_sent,
+		.user_data = (void *)(uintptr_t)changed_at,
+	};
+	int rc = bt_gatt_notify_cb(conn, &params);
+	bt_conn_unref(conn);
+	if (rc != 0){
+		LOG_DBG("hog notify error: %d", rc);
+		key = k_spin_lock(&hog.lock);
+		hog.in_flight = false;
+		k_spin_unlock(&hog.lock, key);
+	}
+}
+
+#ifdef CONFIG_BT_GATT_CLIENT
+static void mtu_exchanged(struct bt_conn *conn, uint8_t err,
+			  struct bt_gatt_exchange_params *params)
+{
+	LOG_INF("hog: mtu exchange %s, mtu %u", err ? "failed" : "done", bt_gatt_get_mtu(conn));
+}
+
+static struct bt_gatt_exchange_params mtu_params = {
+	.func = mtu_exchanged,
+};
+#endif
+
+/**
+ * @brief Ask for the fastest link available once connected. This runs
+ * from the system workqueue, as some of these wait on HCI commands
+ * which can not be done from the connection callbacks.
+ *
+ */
+static void conn_update_handler(struct k_work *work){
+	k_spinlock_key_t key = k_spin_lock(&hog.lock);
+	struct bt_conn * conn = hog.conn ? bt_conn_ref(hog.conn) : NULL;
+	k_spin_unlock(&hog.lock, key);
+	if (conn == NULL){
+		return;
+	}
+	const struct bt_le_conn_param param = BT_LE_CONN_PARAM_INIT(
+		HOG_CONN_INTERVAL, HOG_CONN_INTERVAL, 0, HOG_CONN_TIMEOUT);
+	int rc = bt_conn_le_param_update(conn, &param);
+	if (rc != 0){
+		LOG_WRN("hog: connection parameter update failed: %d", rc);
+	}
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+	rc = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+	if (rc != 0){
+		LOG_WRN("hog: phy update failed: %d", rc);
+	}
+#endif
+#ifdef CONFIG_BT_USER_DATA_LEN_UPDATE
+	rc = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+	if (rc != 0){
+		LOG_WRN("hog: data length update failed: %d", rc);
+	}
+#endif
+#ifdef CONFIG_BT_GATT_CLIENT
+	rc = bt_gatt_exchange_mtu(conn, &mtu_params);
+	if (rc != 0){
+		LOG_WRN("hog: mtu exchange failed: %d", rc);
+	}
+#endif
+	bt_conn_unref(conn);
+}
+
+K_WORK_DEFINE(conn_update_work, conn_update_handler);
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	if (err) {
+		LOG_ERR("hog: connection failed (err %u)", err);
+		return;
+	}
+	k_spinlock_key_t key = k_spin_lock(&hog.lock);
+	if (hog.conn != NULL){
+		k_spin_unlock(&hog.lock, key);
+		return;
+	}
+	hog.conn = bt_conn_ref(conn);
+	hog.in_flight = false;
+	memset(hog.sent, 0, sizeof(hog.sent));
+	memset(hog.pressed, 0, sizeof(hog.pressed));
+	memset(hog.released, 0, sizeof(hog.released));
+	k_spin_unlock(&hog.lock, key);
+	LOG_INF("hog: connected");
+	k_work_submit(&conn_update_work);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	k_spinlock_key_t key = k_spin_lock(&hog.lock);
+	if (hog.conn != conn){
+		k_spin_unlock(&hog.lock, key);
+		return;
+	}
+	bt_conn_unref(hog.conn);
+	hog.conn = NULL;
+	hog.notify = false;
+	hog.in_flight = false;
+	k_spin_unlock(&hog.lock, key);
+	LOG_INF("hog: disconnected (reason 0x%02x)", reason);
+}
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval,
+			     uint16_t latency, uint16_t timeout)
+{
+	LOG_INF("hog: interval %u us, latency %u, timeout %u ms",
+		interval * 1250, latency, timeout * 10);
+}
+
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+static void le_phy_updated(struct bt_conn *conn,
+			   struct bt_conn_le_phy_info *param)
+{
+	LOG_INF("hog: tx phy %u, rx phy %u", param->tx_phy, param->rx_phy);
+}
+#endif
+
+BT_CONN_CB_DEFINE(hog_conn_callbacks) = {
+	.connected = connected,
+	.disconnected = disconnected,
+	.le_param_updated = le_param_updated,
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+	.le_phy_updated = le_phy_updated,
+#endif
+};
+
+void hog_process(void){
+	int rc = bt_enable(NULL);
+	if (rc != 0){
+		LOG_ERR("Bluetooth init failed: %d", rc);
+		return;
+	}
+	if (IS_ENABLED(CONFIG_SETTINGS)) {
+		settings_load();
+	}
+	rc = bt_le_adv_start(BT_LE_ADV_CONN_NAME, ad, ARRAY_SIZE(ad), NULL, 0);
+	if (rc != 0){
+		LOG_ERR("Advertising failed to start: %d", rc);
+		return;
+	}
+#ifdef CONFIG_SHREDLINK_BLE_HOG_STATS
+	hog_stats.start = k_uptime_get();
+#endif
+	while (1){
+		k_sem_take(&hog_sem, K_FOREVER);
+		hog_send_pending();
+	}
+}
+
+K_THREAD_DEFINE(hog_reporting, CONFIG_SHREDLINK_BLE_HOG_STACKSIZE, hog_process,
+	NULL, NULL, NULL, CONFIG_SHREDLINK_BLE_HOG_PRIORITY, 0, 0);
@@ -9,13 +9,20 @@
  * SPDX-License-Identifier: Apache-2.0
  * 
  */
+
+#define DT_DRV_COMPAT shredlink_hid_gamepad
+
 #include <zephyr.h>
-#include <wii.h>
 #include <device.h>
+#include <drivers/gamepad.h>
 #include <sys/util.h>
 #include <logging/log.h>
+#include <pm/device.h>
 #include <shredlink/daq.h>
 #include <shredlink/hid.h>
+#include <shredlink/report.h>
+#include <shredlink/trace.h>
+#include <tracing/tracing_shredlink.h>
 
 LOG_MODULE_DECLARE(shredlink, CONFIG_SHREDLINK_LOG_LEVEL);
 
@@ -25,131 +32,440 @@ K_EVENT_DEFINE(tilt_ev);
 #define EVENT_TILT_INACTIVE	BIT(1)
 
 /**
- * @TODO: This will eventually be moved into the gamepad api
+ * @brief The controller feeding a gamepad, and whether the
+ * tilt sensor should be merged into its report.
  * 
  */
-struct __attribute__((packed)) guitar_data{
-	uint8_t analog_x: 6;
-	uint8_t gh0: 2;
-	uint8_t analog_y: 6;
-	uint8_t gh1: 2;
-	uint8_t touchbar: 5;
-	uint8_t empty0: 3;
-	uint8_t whammy: 5;
-	uint8_t empty1: 3;
-	uint8_t empty2: 2;
-	uint8_t button_plus: 1;
-	uint8_t empty3: 1;
-	uint8_t button_minus: 1;
-	uint8_t empty4: 1;
-	uint8_t strum_down: 1;
-	uint8_t empty5: 1;
-	uint8_t strum_up: 1;
-	uint8_t empty6: 2;
-	uint8_t neck: 5;
+struct gamepad_input{
+	const struct device * dev;
+	bool tilt;
 };
 
-/**
- * @brief This union is a conveient container which allows
- * easily converting between raw frame data, and useful
- * gamepad data without needing to mask and shift everything
- * manually.
- * 
- */
-typedef union wii_data_fmt{
-	struct wii_btn_data frame;
-	struct guitar_data guitar;
-}wii_fmt_t;
+#define GAMEPAD_INPUT_ENTRY(inst) \
+	[inst] = { \
+		.dev = DEVICE_DT_GET(DT_INST_PHANDLE(inst, input)), \
+		.tilt = DT_INST_NODE_HAS_PROP(inst, tilt_sensor), \
+	},
+
+static const struct gamepad_input gamepad_inputs[GAMEPAD_COUNT] = {
+	DT_INST_FOREACH_STATUS_OKAY(GAMEPAD_INPUT_ENTRY)
+};
 
 struct polling_work_item{
     struct k_work_poll work;
     struct k_poll_signal signal;
     struct k_poll_event event;
+    /* Start and end of the poll period being served, in ticks */
+    int64_t release;
+    int64_t deadline;
+    /* Whether the read is due at `release`, rather than on change */
+    bool timed;
+};
+
+/**
+ * @brief Acquisition timing counters, see struct gamepad_daq_stats
+ * 
+ */
+static struct {
+	atomic_t reads;
+	atomic_t missed;
+	atomic_t late;
+	atomic_t overruns;
+	atomic_t max_start_delay;
+} daq_stats;
+
+#ifndef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+static K_THREAD_STACK_DEFINE(daq_workq_stack, CONFIG_SHREDLINK_DAQ_WORKQ_STACKSIZE);
+static struct k_work_q daq_workq;
+#endif
+
+/* Set while the host does not need reports (see gamepad_acquisition_park()) */
+static atomic_t parked;
+/* Report every gamepad on the next pass, changed or not */
+static atomic_t force_report;
+static K_SEM_DEFINE(unpark_sem, 0, 1);
+
+static struct polling_work_item work_item = {
+	/* Raised from other threads and ISRs, possibly before acquisition starts */
+	.signal = K_POLL_SIGNAL_INITIALIZER(work_item.signal),
 };
 
 int signal_tilt_event(bool tilt){
 	uint32_t event = tilt ? EVENT_TILT_ACTIVE : EVENT_TILT_INACTIVE;
 	k_event_set(&tilt_ev, event);
+	k_poll_signal_raise(&work_item.signal, 0);
 	return 0;
 }
 
-static int pack_gamepad_data(struct gamepad * packed, struct wii_btn_data frame, int32_t tilt){
-	if (packed == NULL){
-		return -ENODEV;
+/**
+ * @brief Change handler installed on the gamepad inputs, may run in an ISR.
+ * 
+ * @param dev : gamepad input which changed
+ */
+static void gamepad_changed(const struct device * dev){
+	k_poll_signal_raise(&work_item.signal, 0);
+}
+
+/**
+ * @brief Install the change handler on every gamepad input.
+ * 
+ * @retval true if acquisition can wait for changes
+ * @retval false if it must keep polling
+ */
+static bool enable_wake_on_change(void){
+	if (!IS_ENABLED(CONFIG_GAMEPAD_DAQ_WAKE_ON_CHANGE)){
+		return false;
 	}
-    wii_fmt_t fmt = {
-        .frame = frame
-    };
-	packed->axes[0] = fmt.guitar.analog_x;
-	packed->axes[1] = fmt.guitar.analog_y;
-	packed->axes[2] = fmt.guitar.whammy;
-	packed->buttons = fmt.guitar.neck;
-	WRITE_BIT(packed->buttons, 5, fmt.guitar.button_plus);
-	WRITE_BIT(packed->buttons, 6, fmt.guitar.button_minus);
-	WRITE_BIT(packed->buttons, 7, fmt.guitar.strum_up);
-	WRITE_BIT(packed->buttons, 8, fmt.guitar.strum_down);
-    WRITE_BIT(packed->buttons, 9, !tilt);
-
-    /**
-     * @TODO: The logic level is inverted on the wii guitar I am testing with.
-     * This should be handled in the gamepad API instead of the application layer.
-     * 
-     */
-	packed->buttons ^= UINT32_MAX; /* logic level is inverted */
-	LOG_DBG("report: x: %d y: %d whammy: %d buttons: %02x", packed->axes[0], packed->axes[1], packed->axes[2], packed->buttons);
-	return 0;
+	for (int i = 0; i < GAMEPAD_COUNT; i++){
+		int ret = gamepad_trigger_set(gamepad_inputs[i].dev, gamepad_changed);
+		if (ret != 0){
+			LOG_WRN("gamepad %d can not signal changes (%d), polling instead", i, ret);
+			while (--i >= 0){
+				gamepad_trigger_set(gamepad_inputs[i].dev, NULL);
+			}
+			return false;
+		}
+	}
+	return true;
+}
+
+void gamepad_acquisition_park(bool park){
+	if (atomic_set(&parked, park) != park && !park){
+		k_sem_give(&unpark_sem);
+	}
+}
+
+/**
+ * @brief Run a power management action on every gamepad input, so
+ * that their drivers can release (or take back) their bus.
+ * 
+ * @param action : PM_DEVICE_ACTION_SUSPEND or PM_DEVICE_ACTION_RESUME
+ */
+static void set_inputs_power(enum pm_device_action action){
+#ifdef CONFIG_PM_DEVICE
+	for (int i = 0; i < GAMEPAD_COUNT; i++){
+		int ret = pm_device_action_run(gamepad_inputs[i].dev, action);
+		if (ret != 0 && ret != -ENOSYS && ret != -EALREADY){
+			LOG_WRN("gamepad %d power action %d failed: %d", i, action, ret);
+		}
+	}
+#endif
 }
 
 /**
  * @brief work process which handles data acquisition
- * and submission of a single data frame.
+ * and submission of a single data frame. In run to completion
+ * mode, it is called by the acquisition thread itself and also
+ * samples the tilt sensor and writes the reports to the host.
  * 
  * @param work : work queue entry item
  */
 static void poll_work_item(struct k_work *work){
-    const struct device *wii = DEVICE_DT_GET(DT_NODELABEL(wii_guitar));
-    int ret = 0;
-    struct wii_btn_data data = {0};
-    if ((ret = wii_peripheral_fetch(wii, &data)) != 0){
-        LOG_ERR("gamepad fetch error: %d", ret);
-    }
-    else{
-        /* Data retrieved. Check if tilt data became available */
-		uint32_t events;
-		static int32_t tilt = 0;
-		events = k_event_wait(&tilt_ev, 
-			EVENT_TILT_ACTIVE | EVENT_TILT_INACTIVE, 
-			false, K_NO_WAIT);
-		if (events & EVENT_TILT_ACTIVE){
-			tilt = 1;
-		}
-		else if (events & EVENT_TILT_INACTIVE){
-			tilt = 0;
-		}
-		/* Pack the data and submit it for output */
-        struct gamepad gamepad;
-        pack_gamepad_data(&gamepad, data, tilt);
-        submit_frame_data(&gamepad);
-    }
+	const int64_t start = k_uptime_ticks();
+#ifdef CONFIG_SHREDLINK_TRACEPOINTS
+	/* Reports handed over during this pass */
+	int commits = 0;
+#endif
+	SHREDLINK_TRACEPOINT_ENTER(POLL_TICK, work_item.timed);
+	if (work_item.timed){
+		int64_t delay = start - work_item.release;
+		if (delay > k_us_to_ticks_ceil64(CONFIG_SHREDLINK_DAQ_LATE_THRESHOLD_US)){
+			atomic_inc(&daq_stats.late);
+		}
+		if (delay > atomic_get(&daq_stats.max_start_delay)){
+			atomic_set(&daq_stats.max_start_delay, (atomic_val_t)delay);
+		}
+	}
+	atomic_inc(&daq_stats.reads);
+	/* Changes signaled from now on need another pass */
+	k_poll_signal_reset(&work_item.signal);
+	if (trace_replaying()){
+		/* The replay owns the reports, live input is sent again once it is over */
+		atomic_set(&force_report, 1);
+		SHREDLINK_TRACEPOINT_EXIT(POLL_TICK, 0);
+		return;
+	}
+	/* Check if tilt data became available */
+	uint32_t events;
+	static int32_t tilt = 0;
+	static int32_t last_tilt[GAMEPAD_COUNT];
+	static int last_err[GAMEPAD_COUNT];
+	static bool first_read[GAMEPAD_COUNT];
+	/* Reports the host had not collected, to write again (run to completion only) */
+	static bool unsent[GAMEPAD_COUNT];
+#ifdef CONFIG_SHREDLINK_REPORT_TIMESTAMP
+	static uint16_t sequence[GAMEPAD_COUNT];
+#endif
+#if defined(CONFIG_SHREDLINK_RUN_TO_COMPLETION) && defined(CONFIG_TILT_SENSOR)
+	tilt_poll();
+#endif
+	events = k_event_wait(&tilt_ev, 
+		EVENT_TILT_ACTIVE | EVENT_TILT_INACTIVE, 
+		false, K_NO_WAIT);
+	if (events & EVENT_TILT_ACTIVE){
+		tilt = 1;
+	}
+	else if (events & EVENT_TILT_INACTIVE){
+		tilt = 0;
+	}
+	/* While parked, passes only look for input to wake the host up */
+	bool scanning = atomic_get(&parked);
+	bool force = !scanning && atomic_set(&force_report, 0);
+	for (uint8_t i = 0; i < GAMEPAD_COUNT; i++){
+		const struct gamepad_input * input = &gamepad_inputs[i];
+		const struct gamepad_layout * layout = hid_report_layout(i);
+		/* Decode straight into the report which will be sent */
+		uint8_t * report = hid_report_buffer(i);
+		uint32_t changed = 0;
+#ifdef CONFIG_SHREDLINK_REPORT_TIMESTAMP
+		/* The controller is sampled as the read starts */
+		uint32_t sample_us = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+#endif
+		int ret = gamepad_read(input->dev, layout, report, &changed);
+		if (ret == 0 && !first_read[i]){
+			first_read[i] = true;
+			LOG_INF("boot: gamepad %d first read at %u us", i,
+				(uint32_t)k_ticks_to_us_floor64(k_uptime_ticks()));
+		}
+		else if (ret != last_err[i]){
+			/* Only log transitions, controllers may stay detached for a while */
+			if (ret != 0){
+				LOG_ERR("gamepad %d read error: %d", i, ret);
+			}
+			else {
+				LOG_INF("gamepad %d recovered", i);
+			}
+		}
+		last_err[i] = ret;
+		if (ret != 0){
+			continue;
+		}
+		if (input->tilt){
+			/* The tilt sensor is the last button of the gamepad */
+			gamepad_report_set_button(layout, report, layout->buttons - 1, tilt);
+			if (tilt != last_tilt[i]){
+				changed |= GAMEPAD_CHANGED_BUTTONS;
+				last_tilt[i] = tilt;
+			}
+		}
+		if (scanning){
+#ifdef CONFIG_SHREDLINK_USB_REMOTE_WAKEUP
+			/* Sticks drift and whammy bars rest unevenly, only presses wake the host */
+			if (changed & GAMEPAD_CHANGED_BUTTONS){
+				hid_request_wakeup();
+			}
+#endif
+			continue;
+		}
+		if (changed || force || unsent[i]){
+#ifdef CONFIG_SHREDLINK_REPORT_TIMESTAMP
+			gamepad_report_set_stamp(layout, report, sample_us, sequence[i]++);
+#endif
+			trace_record(i, report, layout->size);
+			unsent[i] = hid_report_commit(i) == -EAGAIN;
+#ifdef CONFIG_SHREDLINK_TRACEPOINTS
+			commits++;
+#endif
+		}
+	}
+	if (work_item.timed && k_uptime_ticks() > work_item.deadline){
+		atomic_inc(&daq_stats.overruns);
+	}
+	SHREDLINK_TRACEPOINT_EXIT(POLL_TICK, commits);
 }
 
-void gamepad_polling_process(void){
-    static struct polling_work_item work_item;
+#ifndef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+struct k_work_q * gamepad_daq_workq(void){
+	return &daq_workq;
+}
+#endif
+
+/**
+ * @brief Run a pass of acquisition: on the acquisition workqueue, or right
+ * away in this thread in run to completion mode.
+ * 
+ * @param wait : how long the pass waits for a change to be signaled
+ */
+static inline void acquire(k_timeout_t wait){
+#ifdef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+	ARG_UNUSED(wait);
+	poll_work_item(&work_item.work.work);
+#else
+	k_work_poll_submit_to_queue(&daq_workq, &work_item.work, &work_item.event, 1, wait);
+#endif
+}
+
+/**
+ * @brief Whether a pass submitted by acquire() is waiting or running
+ * 
+ */
+static inline bool acquire_busy(void){
+#ifdef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+	return false;
+#else
+	return k_work_busy_get(&work_item.work.work) & (K_WORK_QUEUED | K_WORK_RUNNING);
+#endif
+}
+
+/**
+ * @brief Wait for the pass submitted by acquire() to be over
+ * 
+ */
+static inline void acquire_sync(void){
+#ifndef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+	struct k_work_sync sync;
+	k_work_flush(&work_item.work.work, &sync);
+#endif
+}
+
+/**
+ * @brief Cancel the pass submitted by acquire() if it is still waiting
+ * for a change, and wait for it to be over otherwise.
+ * 
+ */
+static inline void acquire_cancel(void){
+#ifndef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+	k_work_poll_cancel(&work_item.work);
+#endif
+	acquire_sync();
+}
+
+void gamepad_daq_stats_get(struct gamepad_daq_stats * stats){
+	stats->reads = atomic_get(&daq_stats.reads);
+	stats->missed = atomic_get(&daq_stats.missed);
+	stats->late = atomic_get(&daq_stats.late);
+	stats->overruns = atomic_get(&daq_stats.overruns);
+	stats->max_start_delay_us = k_ticks_to_us_ceil32(atomic_get(&daq_stats.max_start_delay));
+}
 
+#ifdef CONFIG_SHREDLINK_DAQ_STATS
+static void log_daq_stats(void){
+	static struct gamepad_daq_stats last;
+	struct gamepad_daq_stats now;
+	gamepad_daq_stats_get(&now);
+	LOG_INF("daq: %u reads, %u missed, %u late, %u overruns, worst start delay %u us",
+		now.reads - last.reads, now.missed - last.missed, now.late - last.late,
+		now.overruns - last.overruns, now.max_start_delay_us);
+	last = now;
+}
+#endif
+
+/**
+ * @brief Sit out a period during which the host does not need reports.
+ * 
+ * With remote wakeup, the gamepads keep being scanned at a low rate.
+ * Otherwise the inputs are suspended and the thread blocks, leaving
+ * the SoC idle until acquisition is restarted.
+ * 
+ * @param wait : timeout of the acquisition work in the current mode
+ */
+static void park_acquisition(k_timeout_t wait){
+	LOG_INF("acquisition parked");
+#ifdef CONFIG_SHREDLINK_USB_REMOTE_WAKEUP
+	while (atomic_get(&parked)){
+		work_item.timed = false;
+		acquire(wait);
+		k_sem_take(&unpark_sem, K_USEC(USEC_PER_SEC / CONFIG_SHREDLINK_USB_REMOTE_WAKEUP_SCAN_HZ));
+	}
+#else
+	/* Let the last pass finish before pulling the inputs from under it */
+	acquire_cancel();
+	set_inputs_power(PM_DEVICE_ACTION_SUSPEND);
+	while (atomic_get(&parked)){
+		k_sem_take(&unpark_sem, K_FOREVER);
+	}
+	set_inputs_power(PM_DEVICE_ACTION_RESUME);
+#endif
+	/* Whatever the host had is stale, send every gamepad again */
+	atomic_set(&force_report, 1);
+	k_poll_signal_raise(&work_item.signal, 0);
+	LOG_INF("acquisition resumed");
+}
+
+/**
+ * @brief Start of a poll period, in ticks. Computed from the period index
+ * rather than accumulated, so that rounding never drifts the poll rate.
+ * 
+ * @param origin : start of period 0
+ * @param period : index of the period
+ */
+static inline int64_t period_start(int64_t origin, uint64_t period){
+	return origin + k_us_to_ticks_floor64(period * USEC_PER_SEC / CONFIG_GAMEPAD_POLL_RATE_HZ);
+}
+
+static inline uint64_t period_at(int64_t origin, int64_t ticks){
+	return k_ticks_to_us_floor64(ticks - origin) * CONFIG_GAMEPAD_POLL_RATE_HZ / USEC_PER_SEC;
+}
+
+void gamepad_polling_process(void){
+#ifndef CONFIG_SHREDLINK_RUN_TO_COMPLETION
     k_work_poll_init(&work_item.work, poll_work_item);
-    k_poll_signal_init(&work_item.signal);
     k_poll_event_init(&work_item.event, 
                     K_POLL_TYPE_SIGNAL,
                     K_POLL_MODE_NOTIFY_ONLY,
                     &work_item.signal);
+	k_work_queue_start(&daq_workq, daq_workq_stack,
+		K_THREAD_STACK_SIZEOF(daq_workq_stack), CONFIG_SHREDLINK_DAQ_WORKQ_PRIORITY,
+		&(struct k_work_queue_config){.name = "daq_workq"});
+#endif
+	/* When woken on change, the work only runs once the signal is raised */
+	const k_timeout_t wait = enable_wake_on_change() ? K_FOREVER : K_NO_WAIT;
+	const bool timed = K_TIMEOUT_EQ(wait, K_NO_WAIT);
+	/* Read every gamepad once, whatever the mode */
+	k_poll_signal_raise(&work_item.signal, 0);
 
+	int64_t origin = k_uptime_ticks();
+	uint64_t period = 0;
+#ifdef CONFIG_SHREDLINK_DAQ_STATS
+	int64_t stats_start = k_uptime_get();
+#endif
 	while (1) {
-        /* Submit work to the system workqueue to be processed in parallel
-        to the waiting process. This way, any process latency associated
-        with data acquisition and submission is fully decoupled from the
-        requested poll rate. */
-        k_work_poll_submit(&work_item.work, &work_item.event, 1, K_NO_WAIT);
-		k_usleep(USEC_PER_SEC / CONFIG_GAMEPAD_POLL_RATE_HZ);
+		if (atomic_get(&parked)){
+			park_acquisition(wait);
+			/* Time spent parked is not missed, start a new schedule */
+			origin = k_uptime_ticks();
+			period = 0;
+		}
+		bool busy = acquire_busy();
+#ifdef CONFIG_SHREDLINK_DAQ_SKIP
+		/* Give up on the periods which are already over */
+		uint64_t current = period_at(origin, k_uptime_ticks());
+		if (timed && current > period){
+			atomic_add(&daq_stats.missed, (atomic_val_t)(current - period));
+			period = current;
+		}
+		if (busy && timed){
+			/* The previous read is still going, this period gets none */
+			atomic_inc(&daq_stats.missed);
+		}
+#else
+		if (busy){
+			/* Wait for the previous read, then serve this period late */
+			acquire_sync();
+			busy = false;
+		}
+#endif
+		if (!busy){
+			work_item.release = period_start(origin, period);
+			work_item.deadline = period_start(origin, period + 1);
+			work_item.timed = timed;
+			/* Submit work to the acquisition workqueue to be processed in
+			parallel to the waiting process. This way, any process latency
+			associated with data acquisition and submission is fully
+			decoupled from the requested poll rate. In run to completion
+			mode, the pass runs here instead and sleeping absorbs it. */
+			acquire(wait);
+		}
+		period++;
+#ifdef CONFIG_SHREDLINK_DAQ_STATS
+		if (k_uptime_get() - stats_start >= CONFIG_SHREDLINK_DAQ_STATS_INTERVAL_MS){
+			log_daq_stats();
+			stats_start = k_uptime_get();
+		}
+#endif
+		/* Sleep until the start of the next period, rather than for a
+		whole period, so the time spent above does not slow the rate */
+		k_sleep(K_TIMEOUT_ABS_TICKS(period_start(origin, period)));
 	}
 }
 
@@ -14,6 +14,7 @@
 #include <drivers/sensor.h>
 #include <drivers/sensor/tilt.h>
 #include <shredlink/daq.h>
+#include <tracing/tracing_shredlink.h>
 
 LOG_MODULE_DECLARE(shredlink, CONFIG_SHREDLINK_LOG_LEVEL);
 
@@ -30,19 +31,48 @@ static void tilt_trigger_handler(const struct device *dev,
 {  
 	struct sensor_value tilt;
 	int rc;
+	SHREDLINK_TRACEPOINT_ENTER(TILT_HANDLER, 0);
 	rc = sensor_sample_fetch(dev);
 	if (rc != 0) {
 		LOG_DBG("tilt sensor fetch error: %d", rc);
+		SHREDLINK_TRACEPOINT_EXIT(TILT_HANDLER, rc);
 		return;
 	}
 	rc = sensor_channel_get(dev, SENSOR_CHAN_TILT, &tilt);
 	if (rc != 0) {
 		LOG_DBG("tilt sensor get error: %d", rc);
+		SHREDLINK_TRACEPOINT_EXIT(TILT_HANDLER, rc);
 		return;
 	}
     signal_tilt_event(tilt.val1);
+	SHREDLINK_TRACEPOINT_EXIT(TILT_HANDLER, tilt.val1);
 }
 
+#ifdef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+void tilt_poll(void){
+	const struct device *dev = DEVICE_DT_GET(TILT_SENSOR);
+	static int32_t reported = -1;
+	static int32_t candidate = -1;
+	static int64_t since;
+	struct sensor_value tilt;
+	if (sensor_sample_fetch(dev) != 0 ||
+		sensor_channel_get(dev, SENSOR_CHAN_TILT, &tilt) != 0){
+		return;
+	}
+	int64_t now = k_uptime_get();
+	if (tilt.val1 != candidate){
+		candidate = tilt.val1;
+		since = now;
+	}
+	/* The first sample is reported right away */
+	if (candidate != reported &&
+		(reported < 0 || now - since >= CONFIG_SHREDLINK_RTC_TILT_HOLD_TIME_MS)){
+		reported = candidate;
+		signal_tilt_event(reported);
+	}
+}
+#endif
+
 /**
  * @brief Setup the tilt sensor
  * 
@@ -55,10 +85,14 @@ static int configure_tilt_sensor(){
 	static struct sensor_trigger trig;
 	trig.type = SENSOR_TRIG_THRESHOLD;
 	trig.chan = SENSOR_CHAN_TILT;
+#ifdef CONFIG_SHREDLINK_RUN_TO_COMPLETION
+	/* Sampled by acquisition instead, see tilt_poll() */
+#else
 	rc = sensor_trigger_set(tilt, &trig, tilt_trigger_handler);
 	if (rc != 0) {
 		LOG_ERR("Trigger set failed: %d", rc);
 	}
+#endif
 	/* Manually trigger the handler to populate initial values */
 	tilt_trigger_handler(tilt, &trig);
     return rc;
@@ -0,0 +1,429 @@
+/**
+ * @file trace.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Capture of the reports handed over to the host, and their replay.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Every report committed by acquisition is recorded, along with the cycles
+ * elapsed since the previous one, in a RAM ring which keeps the most recent
+ * entries. A trace can be dumped over the shell, fed back through the shell
+ * (e.g. into the native_posix build), saved to the storage partition, and
+ * replayed through hid_report_commit() at the original timing or faster.
+ * Replay runs on the acquisition workqueue, in place of acquisition.
+ */
+
+#define DT_DRV_COMPAT shredlink_hid_gamepad
+
+#include <string.h>
+#include <zephyr.h>
+#include <logging/log.h>
+#include <sys/util.h>
+#include <shredlink/daq.h>
+#include <shredlink/hid.h>
+#include <shredlink/report.h>
+#include <shredlink/trace.h>
+
+LOG_MODULE_DECLARE(shredlink, CONFIG_SHREDLINK_LOG_LEVEL);
+
+#define TRACE_ENTRY_CHECK(inst) \
+	BUILD_ASSERT(GAMEPAD_REPORT_SIZE(DT_DRV_INST(inst)) <= CONFIG_SHREDLINK_TRACE_REPORT_SIZE, \
+		"CONFIG_SHREDLINK_TRACE_REPORT_SIZE is smaller than a gamepad report");
+DT_INST_FOREACH_STATUS_OKAY(TRACE_ENTRY_CHECK)
+
+#define TRACE_MAGIC	0x31435254	/* "TRC1" */
+
+enum trace_state{
+	TRACE_IDLE,
+	TRACE_CAPTURE,
+	TRACE_REPLAY,
+};
+
+/**
+ * @brief A report, and when it was committed
+ *
+ */
+struct trace_entry{
+	/* Hardware cycles since the previous entry */
+	uint32_t delta;
+	uint8_t gamepad;
+	uint8_t report[CONFIG_SHREDLINK_TRACE_REPORT_SIZE];
+};
+
+/**
+ * @brief Ring of the most recent entries, oldest at `head`. Saved to
+ * flash as is, so the header tells whether a saved trace fits this build.
+ *
+ */
+struct trace_ring{
+	uint32_t magic;
+	uint16_t capacity;
+	uint16_t entry_size;
+	uint16_t head;
+	uint16_t count;
+	uint32_t overwritten;
+	struct trace_entry entries[CONFIG_SHREDLINK_TRACE_ENTRIES];
+};
+
+static struct trace_ring ring = {
+	.magic = TRACE_MAGIC,
+	.capacity = CONFIG_SHREDLINK_TRACE_ENTRIES,
+	.entry_size = sizeof(struct trace_entry),
+};
+static struct k_spinlock lock;
+static atomic_t state;
+
+/* Last entry captured, to timestamp the next one */
+static uint32_t last_cycles;
+static int64_t last_ms;
+
+static void replay_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(replay_work, replay_handler);
+
+/**
+ * @brief Progress of the replay, only touched on the acquisition workqueue
+ *
+ */
+static struct {
+	uint32_t speed;
+	uint16_t next;
+	/* Cycles from the first entry to entry `next`, in the trace */
+	uint64_t elapsed;
+	int64_t start;
+} replay;
+
+static inline struct trace_entry * ring_at(uint16_t i){
+	return &ring.entries[(ring.head + i) % CONFIG_SHREDLINK_TRACE_ENTRIES];
+}
+
+/**
+ * @brief Add an entry at the end of the ring, overwriting the oldest one
+ * when full. Must be called with the lock held.
+ *
+ */
+static struct trace_entry * ring_push(void){
+	struct trace_entry * entry = ring_at(ring.count);
+	if (ring.count == CONFIG_SHREDLINK_TRACE_ENTRIES){
+		ring.head = (ring.head + 1) % CONFIG_SHREDLINK_TRACE_ENTRIES;
+		ring.overwritten++;
+	}
+	else{
+		ring.count++;
+	}
+	return entry;
+}
+
+static void ring_clear(void){
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	ring.head = 0;
+	ring.count = 0;
+	ring.overwritten = 0;
+	k_spin_unlock(&lock, key);
+}
+
+void trace_record(uint8_t gamepad, const uint8_t * report, size_t size){
+	if (atomic_get(&state) != TRACE_CAPTURE){
+		return;
+	}
+	uint32_t now = k_cycle_get_32();
+	int64_t now_ms = k_uptime_get();
+	/* The cycle counter wraps, longer gaps are clamped */
+	const int64_t wrap_ms = (int64_t)UINT32_MAX * MSEC_PER_SEC / sys_clock_hw_cycles_per_sec();
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct trace_entry * entry = ring_push();
+	if (ring.count == 1 && ring.overwritten == 0){
+		entry->delta = 0;
+	}
+	else{
+		entry->delta = (now_ms - last_ms < wrap_ms) ? now - last_cycles : UINT32_MAX;
+	}
+	entry->gamepad = gamepad;
+	memcpy(entry->report, report, MIN(size, sizeof(entry->report)));
+	k_spin_unlock(&lock, key);
+	last_cycles = now;
+	last_ms = now_ms;
+}
+
+bool trace_replaying(void){
+	return atomic_get(&state) == TRACE_REPLAY;
+}
+
+int trace_capture_start(void){
+	if (trace_replaying()){
+		return -EBUSY;
+	}
+	/* Pause a capture in progress while the ring is cleared */
+	atomic_cas(&state, TRACE_CAPTURE, TRACE_IDLE);
+	ring_clear();
+	return atomic_cas(&state, TRACE_IDLE, TRACE_CAPTURE) ? 0 : -EBUSY;
+}
+
+void trace_capture_stop(void){
+	atomic_cas(&state, TRACE_CAPTURE, TRACE_IDLE);
+}
+
+/**
+ * @brief Hand the reports which are due over to the host, then come back
+ * when the next one is.
+ *
+ * @param work : replay_work
+ */
+static void replay_handler(struct k_work *work){
+	while (replay.next < ring.count){
+		const struct trace_entry * entry = ring_at(replay.next);
+		if (replay.speed > 0){
+			int64_t due = replay.start + k_cyc_to_ticks_near64(replay.elapsed / replay.speed);
+			if (due > k_uptime_ticks()){
+				k_work_schedule_for_queue(gamepad_daq_workq(), &replay_work,
+					K_TIMEOUT_ABS_TICKS(due));
+				return;
+			}
+		}
+		/* Traces from builds with more gamepads skip the extra ones */
+		const struct gamepad_layout * layout = hid_report_layout(entry->gamepad);
+		if (layout != NULL){
+			memcpy(hid_report_buffer(entry->gamepad), entry->report,
+				MIN(layout->size, sizeof(entry->report)));
+			hid_report_commit(entry->gamepad);
+		}
+		if (++replay.next < ring.count){
+			replay.elapsed += ring_at(replay.next)->delta;
+		}
+	}
+	LOG_INF("trace replayed, %u reports in %u ms", ring.count,
+		(uint32_t)k_ticks_to_ms_floor64(k_uptime_ticks() - replay.start));
+	atomic_set(&state, TRACE_IDLE);
+}
+
+int trace_replay_start(uint32_t speed){
+	if (ring.count == 0){
+		return -ENODATA;
+	}
+	if (!atomic_cas(&state, TRACE_IDLE, TRACE_REPLAY)){
+		return -EBUSY;
+	}
+	replay.speed = speed;
+	replay.next = 0;
+	replay.elapsed = 0;
+	replay.start = k_uptime_ticks();
+	k_work_schedule_for_queue(gamepad_daq_workq(), &replay_work, K_NO_WAIT);
+	return 0;
+}
+
+#ifdef CONFIG_SHREDLINK_TRACE_FLASH
+#include <storage/flash_map.h>
+
+/**
+ * @brief Write the ring to the storage partition
+ *
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+static int trace_save(void){
+	const struct flash_area * fa;
+	int rc = flash_area_open(FLASH_AREA_ID(storage), &fa);
+	if (rc != 0){
+		return rc;
+	}
+	size_t align = flash_area_align(fa);
+	size_t body = ROUND_DOWN(sizeof(ring), align);
+	uint8_t tail[16];
+	if (align > sizeof(tail) || ROUND_UP(sizeof(ring), align) > fa->fa_size){
+		rc = -ENOSPC;
+	}
+	if (rc == 0){
+		rc = flash_area_erase(fa, 0, fa->fa_size);
+	}
+	if (rc == 0){
+		rc = flash_area_write(fa, 0, &ring, body);
+	}
+	if (rc == 0 && body < sizeof(ring)){
+		/* Flash is written in blocks, pad the end of the ring to one */
+		memset(tail, 0xff, sizeof(tail));
+		memcpy(tail, (const uint8_t *)&ring + body, sizeof(ring) - body);
+		rc = flash_area_write(fa, body, tail, align);
+	}
+	flash_area_close(fa);
+	return rc;
+}
+
+/**
+ * @brief Read the ring back from the storage partition
+ *
+ * @retval 0 on success
+ * @retval -ENOENT if no trace saved by this build is found
+ * @retval -errno otherwise
+ */
+static int trace_load(void){
+	const struct flash_area * fa;
+	int rc = flash_area_open(FLASH_AREA_ID(storage), &fa);
+	if (rc != 0){
+		return rc;
+	}
+	rc = flash_area_read(fa, 0, &ring, sizeof(ring));
+	flash_area_close(fa);
+	if (rc == 0 && (ring.magic != TRACE_MAGIC ||
+		ring.capacity != CONFIG_SHREDLINK_TRACE_ENTRIES ||
+		ring.entry_size != sizeof(struct trace_entry) ||
+		ring.head >= CONFIG_SHREDLINK_TRACE_ENTRIES ||
+		ring.count > CONFIG_SHREDLINK_TRACE_ENTRIES)){
+		rc = -ENOENT;
+	}
+	if (rc != 0){
+		ring.magic = TRACE_MAGIC;
+		ring.capacity = CONFIG_SHREDLINK_TRACE_ENTRIES;
+		ring.entry_size = sizeof(struct trace_entry);
+		ring_clear();
+	}
+	return rc;
+}
+#endif /* CONFIG_SHREDLINK_TRACE_FLASH */
+
+#ifdef CONFIG_SHREDLINK_TRACE_SHELL
+#include <shell/shell.h>
+#include <stdlib.h>
+
+/* Time of the last entry added from the shell, in ns since the first */
+static uint64_t put_last_ns;
+
+static int shell_require_idle(const struct shell *sh){
+	if (atomic_get(&state) != TRACE_IDLE){
+		shell_error(sh, "stop capturing (or wait for the replay) first");
+		return -EBUSY;
+	}
+	return 0;
+}
+
+static int cmd_start(const struct shell *sh, size_t argc, char **argv)
+{
+	int rc = trace_capture_start();
+	if (rc != 0){
+		shell_error(sh, "replay in progress");
+	}
+	return rc;
+}
+
+static int cmd_stop(const struct shell *sh, size_t argc, char **argv)
+{
+	trace_capture_stop();
+	shell_print(sh, "%u reports, %u overwritten", ring.count, ring.overwritten);
+	return 0;
+}
+
+static int cmd_clear(const struct shell *sh, size_t argc, char **argv)
+{
+	int rc = shell_require_idle(sh);
+	if (rc == 0){
+		ring_clear();
+	}
+	return rc;
+}
+
+/**
+ * @brief Print every entry as `<ns since the first> <gamepad> <report in hex>`,
+ * which is also what `trace put` takes.
+ *
+ */
+static int cmd_dump(const struct shell *sh, size_t argc, char **argv)
+{
+	char hex[2 * CONFIG_SHREDLINK_TRACE_REPORT_SIZE + 1];
+	uint64_t cycles = 0;
+	int rc = shell_require_idle(sh);
+	if (rc != 0){
+		return rc;
+	}
+	shell_print(sh, "# %u reports, %u overwritten", ring.count, ring.overwritten);
+	for (uint16_t i = 0; i < ring.count; i++){
+		const struct trace_entry * entry = ring_at(i);
+		const struct gamepad_layout * layout = hid_report_layout(entry->gamepad);
+		size_t size = layout ? MIN(layout->size, sizeof(entry->report)) : 0;
+		if (i > 0){
+			cycles += entry->delta;
+		}
+		bin2hex(entry->report, size, hex, sizeof(hex));
+		shell_print(sh, "%llu %u %s", (unsigned long long)k_cyc_to_ns_floor64(cycles),
+			entry->gamepad, hex);
+	}
+	return 0;
+}
+
+static int cmd_put(const struct shell *sh, size_t argc, char **argv)
+{
+	uint64_t ns = strtoull(argv[1], NULL, 10);
+	uint8_t gamepad = (uint8_t)strtoul(argv[2], NULL, 10);
+	const struct gamepad_layout * layout = hid_report_layout(gamepad);
+	int rc = shell_require_idle(sh);
+	if (rc != 0){
+		return rc;
+	}
+	if (layout == NULL){
+		shell_error(sh, "no gamepad %u", gamepad);
+		return -EINVAL;
+	}
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct trace_entry * entry = ring_push();
+	if (ring.count == 1){
+		put_last_ns = ns;
+	}
+	entry->delta = (uint32_t)MIN(k_ns_to_cyc_near64(ns - put_last_ns), UINT32_MAX);
+	entry->gamepad = gamepad;
+	memset(entry->report, 0, sizeof(entry->report));
+	size_t size = hex2bin(argv[3], strlen(argv[3]), entry->report, layout->size);
+	k_spin_unlock(&lock, key);
+	put_last_ns = ns;
+	if (size != layout->size){
+		shell_warn(sh, "expected %u report bytes, got %zu", layout->size, size);
+	}
+	return 0;
+}
+
+static int cmd_replay(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t speed = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1;
+	int rc = trace_replay_start(speed);
+	if (rc != 0){
+		shell_error(sh, "can not replay: %d", rc);
+	}
+	return rc;
+}
+
+#ifdef CONFIG_SHREDLINK_TRACE_FLASH
+static int cmd_save(const struct shell *sh, size_t argc, char **argv)
+{
+	int rc = shell_require_idle(sh);
+	if (rc == 0 && (rc = trace_save()) != 0){
+		shell_error(sh, "save failed: %d", rc);
+	}
+	return rc;
+}
+
+static int cmd_load(const struct shell *sh, size_t argc, char **argv)
+{
+	int rc = shell_require_idle(sh);
+	if (rc == 0 && (rc = trace_load()) != 0){
+		shell_error(sh, "load failed: %d", rc);
+	}
+	return rc;
+}
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_trace,
+	SHELL_CMD_ARG(start, NULL, "Start capturing, discarding the current trace", cmd_start, 1, 0),
+	SHELL_CMD_ARG(stop, NULL, "Stop capturing", cmd_stop, 1, 0),
+	SHELL_CMD_ARG(clear, NULL, "Discard the current trace", cmd_clear, 1, 0),
+	SHELL_CMD_ARG(dump, NULL, "Print the trace", cmd_dump, 1, 0),
+	SHELL_CMD_ARG(put, NULL, "<ns> <gamepad> <report in hex>", cmd_put, 4, 0),
+	SHELL_CMD_ARG(replay, NULL, "[speed, 1 = original timing, 0 = back to back]",
+		cmd_replay, 1, 1),
+#ifdef CONFIG_SHREDLINK_TRACE_FLASH
+	SHELL_CMD_ARG(save, NULL, "Save the trace to the storage partition", cmd_save, 1, 0),
+	SHELL_CMD_ARG(load, NULL, "Load the trace from the storage partition", cmd_load, 1, 0),
+#endif
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(trace, &sub_trace, "Gamepad report traces", NULL);
+#endif /* CONFIG_SHREDLINK_TRACE_SHELL */
@@ -0,0 +1,274 @@
+/**
+ * @file gpio_gamepad.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Gamepad with its buttons wired directly to GPIO pins.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * At init, the buttons are grouped by port, and consecutive pins mapping to
+ * consecutive buttons are merged into runs. A sample is then one raw read per
+ * port, followed by one mask and shift per run, instead of one pin read per
+ * button. Active low pins are flipped with a single xor per port.
+ */
+
+#define DT_DRV_COMPAT shredlink_gpio_gamepad
+
+#include <errno.h>
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/gpio.h>
+#include <drivers/gamepad.h>
+#include <logging/log.h>
+
+LOG_MODULE_REGISTER(gpio_gamepad, CONFIG_GAMEPAD_LOG_LEVEL);
+
+/**
+ * @brief Consecutive pins of a port which map to consecutive buttons
+ *
+ */
+struct gpio_gamepad_run{
+	/* Index of the port in gpio_gamepad_data.ports */
+	uint8_t port;
+	uint8_t pin;
+	uint8_t button;
+	uint8_t len;
+};
+
+/**
+ * @brief A port holding at least one button
+ *
+ */
+struct gpio_gamepad_port{
+	const struct device * port;
+	gpio_port_pins_t pins;
+	/* Active low pins, flipped after sampling */
+	gpio_port_value_t invert;
+	/* Last sample, logical levels */
+	gpio_port_value_t value;
+#ifdef CONFIG_GPIO_GAMEPAD_TRIGGER
+	struct gpio_callback cb;
+	const struct device * dev;
+#endif
+};
+
+/**
+ * @brief configuration data for gpio gamepad
+ *
+ */
+struct gpio_gamepad_config{
+	const struct gpio_dt_spec * buttons;
+	uint8_t count;
+};
+
+/**
+ * @brief Device driver data for gpio gamepad. `ports` and `runs`
+ * hold as many entries as there are buttons, the worst case.
+ *
+ */
+struct gpio_gamepad_data{
+	struct gpio_gamepad_port * ports;
+	struct gpio_gamepad_run * runs;
+	uint8_t nports;
+	uint8_t nruns;
+	uint32_t last;
+	bool last_valid;
+#ifdef CONFIG_GPIO_GAMEPAD_TRIGGER
+	gamepad_trigger_handler_t handler;
+#endif
+};
+
+/**
+ * @brief Sample every button
+ *
+ * @param dev : pointer to device driver
+ * @param buttons : set to the state of the buttons, button 0 being bit 0
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+static int gpio_gamepad_sample(const struct device * dev, uint32_t * buttons){
+	struct gpio_gamepad_data *data = dev->data;
+	uint32_t state = 0;
+	for (int i = 0; i < data->nports; i++){
+		struct gpio_gamepad_port * port = &data->ports[i];
+		int rc = gpio_port_get_raw(port->port, &port->value);
+		if (rc != 0){
+			return rc;
+		}
+		port->value ^= port->invert;
+	}
+	for (int i = 0; i < data->nruns; i++){
+		const struct gpio_gamepad_run * run = &data->runs[i];
+		state |= ((data->ports[run->port].value >> run->pin) & BIT_MASK(run->len)) << run->button;
+	}
+	*buttons = state;
+	return 0;
+}
+
+static int gpio_gamepad_read(const struct device * dev, const struct gamepad_layout * layout,
+	uint8_t * report, uint32_t * changed){
+	struct gpio_gamepad_data *data = dev->data;
+	uint32_t buttons;
+	int rc = gpio_gamepad_sample(dev, &buttons);
+	if (rc != 0){
+		return rc;
+	}
+	if (!data->last_valid){
+		*changed = GAMEPAD_CHANGED_ALL;
+	}
+	else{
+		*changed = (buttons != data->last) ? GAMEPAD_CHANGED_BUTTONS : 0;
+	}
+	data->last = buttons;
+	data->last_valid = true;
+
+	gamepad_report_clear(layout, report);
+	gamepad_report_set_buttons(layout, report, buttons);
+	return 0;
+}
+
+#ifdef CONFIG_GPIO_GAMEPAD_TRIGGER
+static void gpio_gamepad_isr(const struct device *gpio, struct gpio_callback *cb,
+	gpio_port_pins_t pins){
+	struct gpio_gamepad_port * port = CONTAINER_OF(cb, struct gpio_gamepad_port, cb);
+	struct gpio_gamepad_data *data = port->dev->data;
+	gamepad_trigger_handler_t handler = data->handler;
+	if (handler != NULL){
+		handler(port->dev);
+	}
+}
+
+static int gpio_gamepad_trigger_set(const struct device * dev, gamepad_trigger_handler_t handler){
+	const struct gpio_gamepad_config *cfg = dev->config;
+	struct gpio_gamepad_data *data = dev->data;
+	gpio_flags_t flags = (handler != NULL) ? GPIO_INT_EDGE_BOTH : GPIO_INT_DISABLE;
+	data->handler = handler;
+	for (int i = 0; i < cfg->count; i++){
+		int rc = gpio_pin_interrupt_configure_dt(&cfg->buttons[i], flags);
+		if (rc != 0){
+			return rc;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Register one callback per port, covering all of its buttons.
+ * Interrupts stay disabled until a handler is installed.
+ *
+ * @param dev : pointer to device driver
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+static int gpio_gamepad_setup_interrupts(const struct device * dev){
+	struct gpio_gamepad_data *data = dev->data;
+	for (int i = 0; i < data->nports; i++){
+		struct gpio_gamepad_port * port = &data->ports[i];
+		port->dev = dev;
+		gpio_init_callback(&port->cb, gpio_gamepad_isr, port->pins);
+		int rc = gpio_add_callback(port->port, &port->cb);
+		if (rc != 0){
+			return rc;
+		}
+	}
+	return 0;
+}
+#endif /* CONFIG_GPIO_GAMEPAD_TRIGGER */
+
+/**
+ * @brief Configure every button as an input, and build the
+ * port and run tables used for sampling.
+ *
+ * @param dev : pointer to device driver
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+static int gpio_gamepad_init(const struct device * dev){
+	const struct gpio_gamepad_config *cfg = dev->config;
+	struct gpio_gamepad_data *data = dev->data;
+	data->nports = 0;
+	data->nruns = 0;
+	for (uint8_t i = 0; i < cfg->count; i++){
+		const struct gpio_dt_spec * spec = &cfg->buttons[i];
+		if (!device_is_ready(spec->port)){
+			LOG_ERR("GPIO device for button %d is not ready.", i);
+			return -ENODEV;
+		}
+		int rc = gpio_pin_configure_dt(spec, GPIO_INPUT);
+		if (rc != 0){
+			return rc;
+		}
+		uint8_t p = 0;
+		while (p < data->nports && data->ports[p].port != spec->port){
+			p++;
+		}
+		if (p == data->nports){
+			data->ports[data->nports++] = (struct gpio_gamepad_port){
+				.port = spec->port,
+			};
+		}
+		data->ports[p].pins |= BIT(spec->pin);
+		if (spec->dt_flags & GPIO_ACTIVE_LOW){
+			data->ports[p].invert |= BIT(spec->pin);
+		}
+		/* Extend the previous run if this button sits on the next pin of the same port */
+		struct gpio_gamepad_run * run = data->nruns ? &data->runs[data->nruns - 1] : NULL;
+		if (run != NULL && run->port == p && run->pin + run->len == spec->pin){
+			run->len++;
+		}
+		else{
+			data->runs[data->nruns++] = (struct gpio_gamepad_run){
+				.port = p,
+				.pin = spec->pin,
+				.button = i,
+				.len = 1,
+			};
+		}
+	}
+	LOG_DBG("%s: %d buttons, %d port reads, %d runs", dev->name,
+		cfg->count, data->nports, data->nruns);
+#ifdef CONFIG_GPIO_GAMEPAD_TRIGGER
+	return gpio_gamepad_setup_interrupts(dev);
+#else
+	return 0;
+#endif
+}
+
+static const struct gamepad_driver_api gpio_gamepad_api_funcs = {
+	.read = gpio_gamepad_read,
+#ifdef CONFIG_GPIO_GAMEPAD_TRIGGER
+	.trigger_set = gpio_gamepad_trigger_set,
+#endif
+};
+
+#define GPIO_GAMEPAD_BUTTON(node_id, prop, idx) \
+	GPIO_DT_SPEC_GET_BY_IDX(node_id, prop, idx),
+
+#define GPIO_GAMEPAD_DEFINE(inst) \
+	BUILD_ASSERT(DT_INST_PROP_LEN(inst, button_gpios) <= 32, \
+		"a gpio gamepad has at most 32 buttons"); \
+	static const struct gpio_dt_spec gpio_gamepad_buttons_##inst[] = { \
+		DT_INST_FOREACH_PROP_ELEM(inst, button_gpios, GPIO_GAMEPAD_BUTTON) \
+	}; \
+	static struct gpio_gamepad_port \
+		gpio_gamepad_ports_##inst[ARRAY_SIZE(gpio_gamepad_buttons_##inst)]; \
+	static struct gpio_gamepad_run \
+		gpio_gamepad_runs_##inst[ARRAY_SIZE(gpio_gamepad_buttons_##inst)]; \
+	\
+	static struct gpio_gamepad_data gpio_gamepad_data_##inst = { \
+		.ports = gpio_gamepad_ports_##inst, \
+		.runs = gpio_gamepad_runs_##inst, \
+	}; \
+	\
+	static const struct gpio_gamepad_config gpio_gamepad_cfg_##inst = { \
+		.buttons = gpio_gamepad_buttons_##inst, \
+		.count = ARRAY_SIZE(gpio_gamepad_buttons_##inst), \
+	}; \
+	\
+	DEVICE_DT_INST_DEFINE(inst, gpio_gamepad_init, NULL, \
+			&gpio_gamepad_data_##inst, &gpio_gamepad_cfg_##inst, POST_KERNEL, \
+			CONFIG_APPLICATION_INIT_PRIORITY, &gpio_gamepad_api_funcs);
+
+DT_INST_FOREACH_STATUS_OKAY(GPIO_GAMEPAD_DEFINE)
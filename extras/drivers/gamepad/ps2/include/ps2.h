@@ -0,0 +1,59 @@
+/**
+ * @file ps2.h
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief PS2 controller protocol, shared by the driver and its emulator
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Every exchange is full duplex: the host clocks a command out while the
+ * controller clocks its reply back. A reply starts with a 3 byte header
+ * (0xff, mode id, 0x5a) followed by the payload of the current mode.
+ */
+
+#ifndef SHREDLINK_DRIVERS_GAMEPAD_PS2_H_
+#define SHREDLINK_DRIVERS_GAMEPAD_PS2_H_
+
+#include <sys/util.h>
+
+#define PS2_ADDR			0x01
+#define PS2_CMD_POLL		0x42
+#define PS2_CMD_CONFIG		0x43
+#define PS2_CMD_SET_MODE	0x44
+
+/* Mode ids (second byte of a reply), the low nibble is the payload size in words */
+#define PS2_ID_DIGITAL		0x41
+#define PS2_ID_ANALOG		0x73
+#define PS2_ID_PRESSURE		0x79
+#define PS2_ID_CONFIG		0xf3
+#define PS2_ID_PAYLOAD(id)	(((id) & 0x0f) * 2)
+
+#define PS2_READY			0x5a
+#define PS2_MODE_LOCK		0x03
+
+#define PS2_HEADER_LEN		3
+#define PS2_DIGITAL_FRAME	(PS2_HEADER_LEN + PS2_ID_PAYLOAD(PS2_ID_DIGITAL))
+#define PS2_ANALOG_FRAME	(PS2_HEADER_LEN + PS2_ID_PAYLOAD(PS2_ID_ANALOG))
+#define PS2_MAX_FRAME		PS2_ANALOG_FRAME
+
+/* Bits of the (active low) 16 bit button word of a reply */
+#define PS2_BTN_SELECT		BIT(0)
+#define PS2_BTN_L3			BIT(1)
+#define PS2_BTN_R3			BIT(2)
+#define PS2_BTN_START		BIT(3)
+#define PS2_BTN_UP			BIT(4)
+#define PS2_BTN_RIGHT		BIT(5)
+#define PS2_BTN_DOWN		BIT(6)
+#define PS2_BTN_LEFT		BIT(7)
+#define PS2_BTN_L2			BIT(8)
+#define PS2_BTN_R2			BIT(9)
+#define PS2_BTN_L1			BIT(10)
+#define PS2_BTN_R1			BIT(11)
+#define PS2_BTN_TRIANGLE	BIT(12)
+#define PS2_BTN_CIRCLE		BIT(13)
+#define PS2_BTN_CROSS		BIT(14)
+#define PS2_BTN_SQUARE		BIT(15)
+
+#endif /* SHREDLINK_DRIVERS_GAMEPAD_PS2_H_ */
@@ -0,0 +1,68 @@
+/**
+ * @file ps2_emul.h
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Control of the emulated PS2 controller, for tests and benchmarks.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#ifndef SHREDLINK_DRIVERS_GAMEPAD_PS2_EMUL_H_
+#define SHREDLINK_DRIVERS_GAMEPAD_PS2_EMUL_H_
+
+#include <zephyr/types.h>
+#include <drivers/emul.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bus activity seen by the emulator since the last reset
+ *
+ */
+struct ps2_emul_stats {
+	uint32_t transfers;
+	uint32_t bytes;
+	/* Time the bytes took on the wire, at the clock they were sent with */
+	uint64_t bus_ns;
+	/* Clock of the last transfer */
+	uint32_t frequency;
+	/* Mode the controller is in */
+	uint8_t mode_id;
+};
+
+/**
+ * @brief Set the buttons held down, as PS2_BTN_* bits (1 = pressed)
+ */
+int ps2_emul_set_buttons(const struct emul *target, uint16_t pressed);
+
+/**
+ * @brief Set the analog sticks: right x, right y, left x, left y
+ */
+int ps2_emul_set_sticks(const struct emul *target, const uint8_t sticks[4]);
+
+/**
+ * @brief Fastest clock the emulated controller answers correctly at.
+ * Replies to faster transfers read as all ones, like a floating line.
+ */
+int ps2_emul_set_max_frequency(const struct emul *target, uint32_t frequency);
+
+/**
+ * @brief (Dis)connect the controller. A disconnected controller
+ * leaves the data line floating, and resets to digital mode.
+ */
+int ps2_emul_set_connected(const struct emul *target, bool connected);
+
+int ps2_emul_get_stats(const struct emul *target, struct ps2_emul_stats *stats);
+
+int ps2_emul_reset_stats(const struct emul *target);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHREDLINK_DRIVERS_GAMEPAD_PS2_EMUL_H_ */
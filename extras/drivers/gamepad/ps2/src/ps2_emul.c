@@ -0,0 +1,253 @@
+/**
+ * @file ps2_emul.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Emulated PS2 controller, attached to an emulated SPI controller.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Implements the poll, config, and set mode commands, and models the
+ * fastest clock a real controller keeps up with. It also accounts for the
+ * time every transfer spends on the wire, so that bus usage can be
+ * benchmarked without hardware.
+ */
+
+#define DT_DRV_COMPAT shredlink_ps2_gamepad
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/emul.h>
+#include <drivers/spi.h>
+#include <drivers/spi_emul.h>
+#include <logging/log.h>
+#include <ps2.h>
+#include <ps2_emul.h>
+
+LOG_MODULE_REGISTER(ps2_emul, CONFIG_GAMEPAD_LOG_LEVEL);
+
+/* Sticks at rest */
+#define PS2_STICK_CENTER	0x80
+
+/**
+ * @brief Run time data of an emulated controller
+ *
+ */
+struct ps2_emul_data {
+	struct spi_emul emul_spi;
+	struct k_spinlock lock;
+	uint16_t pressed;
+	uint8_t sticks[4];
+	uint32_t max_frequency;
+	bool connected;
+	bool config;
+	bool analog;
+	struct ps2_emul_stats stats;
+};
+
+/**
+ * @brief Static configuration of an emulated controller
+ *
+ */
+struct ps2_emul_cfg {
+	struct ps2_emul_data *data;
+	uint16_t chipsel;
+};
+
+static struct ps2_emul_data * ps2_emul_get_data(const struct emul *target){
+	const struct ps2_emul_cfg *cfg = target->cfg;
+	return cfg->data;
+}
+
+int ps2_emul_set_buttons(const struct emul *target, uint16_t pressed){
+	if (target == NULL){
+		return -EINVAL;
+	}
+	ps2_emul_get_data(target)->pressed = pressed;
+	return 0;
+}
+
+int ps2_emul_set_sticks(const struct emul *target, const uint8_t sticks[4]){
+	if (target == NULL || sticks == NULL){
+		return -EINVAL;
+	}
+	struct ps2_emul_data *data = ps2_emul_get_data(target);
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+	memcpy(data->sticks, sticks, sizeof(data->sticks));
+	k_spin_unlock(&data->lock, key);
+	return 0;
+}
+
+int ps2_emul_set_max_frequency(const struct emul *target, uint32_t frequency){
+	if (target == NULL){
+		return -EINVAL;
+	}
+	ps2_emul_get_data(target)->max_frequency = frequency;
+	return 0;
+}
+
+int ps2_emul_set_connected(const struct emul *target, bool connected){
+	if (target == NULL){
+		return -EINVAL;
+	}
+	struct ps2_emul_data *data = ps2_emul_get_data(target);
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+	data->connected = connected;
+	if (!connected){
+		data->config = false;
+		data->analog = false;
+	}
+	k_spin_unlock(&data->lock, key);
+	return 0;
+}
+
+int ps2_emul_get_stats(const struct emul *target, struct ps2_emul_stats *stats){
+	if (target == NULL || stats == NULL){
+		return -EINVAL;
+	}
+	struct ps2_emul_data *data = ps2_emul_get_data(target);
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+	*stats = data->stats;
+	stats->mode_id = data->config ? PS2_ID_CONFIG :
+		(data->analog ? PS2_ID_ANALOG : PS2_ID_DIGITAL);
+	k_spin_unlock(&data->lock, key);
+	return 0;
+}
+
+int ps2_emul_reset_stats(const struct emul *target){
+	if (target == NULL){
+		return -EINVAL;
+	}
+	struct ps2_emul_data *data = ps2_emul_get_data(target);
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+	memset(&data->stats, 0, sizeof(data->stats));
+	k_spin_unlock(&data->lock, key);
+	return 0;
+}
+
+/**
+ * @brief Build the reply to the command in `tx`, and apply the command.
+ * Bytes past the payload of the current mode read as 0xff.
+ *
+ */
+static void ps2_emul_reply(struct ps2_emul_data *data, const uint8_t *tx, uint8_t *rx, size_t len){
+	uint8_t reply[PS2_MAX_FRAME];
+	uint8_t id = data->config ? PS2_ID_CONFIG :
+		(data->analog ? PS2_ID_ANALOG : PS2_ID_DIGITAL);
+	size_t reply_len = PS2_HEADER_LEN + PS2_ID_PAYLOAD(id);
+
+	memset(reply, 0xff, sizeof(reply));
+	reply[1] = id;
+	reply[2] = PS2_READY;
+	if (data->config){
+		memset(&reply[PS2_HEADER_LEN], 0x00, PS2_ID_PAYLOAD(id));
+	}
+	else{
+		/* Buttons are active low */
+		reply[3] = ~data->pressed & 0xff;
+		reply[4] = ~data->pressed >> 8;
+		if (data->analog){
+			memcpy(&reply[5], data->sticks, sizeof(data->sticks));
+		}
+	}
+	memcpy(rx, reply, MIN(len, reply_len));
+
+	if (len < 4 || tx[0] != PS2_ADDR){
+		return;
+	}
+	switch (tx[1]){
+	case PS2_CMD_CONFIG:
+		data->config = (tx[3] == 0x01);
+		break;
+	case PS2_CMD_SET_MODE:
+		if (data->config){
+			data->analog = (tx[3] & 0x01);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Handle a transfer addressed to the emulated controller.
+ *
+ * @retval 0 on success, a disconnected controller or a clock which is
+ * too fast corrupt the reply but not the transfer itself.
+ * @retval -EIO on a transfer longer than any PS2 frame
+ */
+static int ps2_emul_io(struct spi_emul *emul, const struct spi_config *config,
+			const struct spi_buf_set *tx_bufs, const struct spi_buf_set *rx_bufs)
+{
+	struct ps2_emul_data *data = CONTAINER_OF(emul, struct ps2_emul_data, emul_spi);
+	uint8_t tx[PS2_MAX_FRAME] = {0};
+	uint8_t rx[PS2_MAX_FRAME];
+	size_t len = 0;
+
+	if (tx_bufs != NULL){
+		for (int i = 0; i < tx_bufs->count; i++){
+			const struct spi_buf *buf = &tx_bufs->buffers[i];
+			if (len + buf->len > sizeof(tx)){
+				return -EIO;
+			}
+			if (buf->buf != NULL){
+				memcpy(&tx[len], buf->buf, buf->len);
+			}
+			len += buf->len;
+		}
+	}
+	memset(rx, 0xff, sizeof(rx));
+
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+	data->stats.transfers++;
+	data->stats.bytes += len;
+	data->stats.bus_ns += (uint64_t)len * 8 * NSEC_PER_SEC / config->frequency;
+	data->stats.frequency = config->frequency;
+	if (data->connected && config->frequency <= data->max_frequency){
+		ps2_emul_reply(data, tx, rx, len);
+	}
+	k_spin_unlock(&data->lock, key);
+
+	if (rx_bufs != NULL){
+		size_t offset = 0;
+		for (int i = 0; i < rx_bufs->count && offset < len; i++){
+			const struct spi_buf *buf = &rx_bufs->buffers[i];
+			size_t n = MIN(buf->len, len - offset);
+			if (buf->buf != NULL){
+				memcpy(buf->buf, &rx[offset], n);
+			}
+			offset += n;
+		}
+	}
+	return 0;
+}
+
+static const struct spi_emul_api ps2_emul_api_spi = {
+	.io = ps2_emul_io,
+};
+
+static int ps2_emul_init(const struct emul *emul, const struct device *parent)
+{
+	const struct ps2_emul_cfg *cfg = emul->cfg;
+	struct ps2_emul_data *data = cfg->data;
+
+	data->emul_spi.api = &ps2_emul_api_spi;
+	data->emul_spi.chipsel = cfg->chipsel;
+	memset(data->sticks, PS2_STICK_CENTER, sizeof(data->sticks));
+	data->max_frequency = CONFIG_PS2_GAMEPAD_EMUL_MAX_FREQUENCY;
+	data->connected = true;
+	return spi_emul_register(parent, emul->dev_label, &data->emul_spi);
+}
+
+#define PS2_EMUL(n) \
+	static struct ps2_emul_data ps2_emul_data_##n; \
+	static const struct ps2_emul_cfg ps2_emul_cfg_##n = { \
+		.data = &ps2_emul_data_##n, \
+		.chipsel = DT_INST_REG_ADDR(n), \
+	}; \
+	EMUL_DEFINE(ps2_emul_init, DT_DRV_INST(n), &ps2_emul_cfg_##n)
+
+DT_INST_FOREACH_STATUS_OKAY(PS2_EMUL)
@@ -0,0 +1,296 @@
+/**
+ * @file ps2_gamepad.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief PS2 controllers (and guitars) over SPI.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * A controller is attached on the first read, and again after any invalid
+ * reply. While none answers, attaching is retried every
+ * CONFIG_PS2_GAMEPAD_ATTACH_INTERVAL_MS. Attaching finds the fastest clock at which every probe poll gets a
+ * valid reply, then switches the controller to the shortest reply mode
+ * carrying what the report needs (digital when there are no axes, analog
+ * otherwise) and locks it there. Each exchange is a single full duplex
+ * transceive of a buffer held in RAM, so SPI controllers with DMA move the
+ * whole frame without CPU involvement.
+ */
+
+#define DT_DRV_COMPAT shredlink_ps2_gamepad
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/spi.h>
+#include <drivers/gamepad.h>
+#include <logging/log.h>
+#include <ps2.h>
+
+LOG_MODULE_REGISTER(ps2_gamepad, CONFIG_GAMEPAD_LOG_LEVEL);
+
+#define PS2_MAX_CLOCKS		8
+#define PS2_AXES			4
+#define PS2_SPI_OPERATION	(SPI_OP_MODE_MASTER | SPI_TRANSFER_LSB | \
+	SPI_MODE_CPOL | SPI_MODE_CPHA | SPI_WORD_SET(8))
+
+/**
+ * @brief PS2 buttons in gamepad order. The first nine match the wii
+ * guitar: frets (green, red, yellow, blue, orange), plus, minus, strum
+ * up and strum down. The rest follow for regular controllers.
+ */
+static const uint16_t ps2_buttons[] = {
+	PS2_BTN_R2, PS2_BTN_CIRCLE, PS2_BTN_TRIANGLE, PS2_BTN_CROSS, PS2_BTN_SQUARE,
+	PS2_BTN_START, PS2_BTN_SELECT, PS2_BTN_UP, PS2_BTN_DOWN,
+	PS2_BTN_LEFT, PS2_BTN_RIGHT, PS2_BTN_L1, PS2_BTN_R1, PS2_BTN_L2,
+	PS2_BTN_L3, PS2_BTN_R3,
+};
+
+/* Command frames, sized for the longest reply they may get back */
+static const uint8_t ps2_poll_cmd[PS2_MAX_FRAME] = {PS2_ADDR, PS2_CMD_POLL};
+static const uint8_t ps2_enter_config_cmd[PS2_MAX_FRAME] = {PS2_ADDR, PS2_CMD_CONFIG, 0x00, 0x01};
+static const uint8_t ps2_exit_config_cmd[PS2_MAX_FRAME] = {PS2_ADDR, PS2_CMD_CONFIG, 0x00, 0x00,
+	0x5a, 0x5a, 0x5a, 0x5a, 0x5a};
+
+/**
+ * @brief configuration data for ps2 gamepad
+ *
+ */
+struct ps2_gamepad_config {
+	struct spi_dt_spec bus;
+};
+
+/**
+ * @brief Device driver data for ps2 gamepad
+ *
+ */
+struct ps2_gamepad_data {
+	/* One configuration per candidate clock, fastest first. SPI drivers only
+	reconfigure the bus when handed a different configuration. */
+	struct spi_config clocks[PS2_MAX_CLOCKS];
+	uint8_t nclocks;
+	/* Configuration in use, NULL while no controller is attached */
+	const struct spi_config * spi;
+	bool analog;
+	uint8_t mode_id;
+	uint8_t frame_len;
+	/* Transfer buffers, in RAM so that DMA can reach them */
+	uint8_t tx[PS2_MAX_FRAME];
+	uint8_t rx[PS2_MAX_FRAME];
+	uint16_t last_buttons;
+	uint8_t last_axes[PS2_AXES];
+	bool last_valid;
+	/* Uptime (ms) before which attaching is not attempted again */
+	int64_t next_attach;
+};
+
+/**
+ * @brief Clock `cmd` out while clocking the reply into the rx buffer
+ *
+ * @param dev : pointer to device driver
+ * @param spi : bus configuration (clock) to use
+ * @param cmd : command frame, may be the tx buffer itself
+ * @param len : bytes to exchange
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+static int ps2_exchange(const struct device * dev, const struct spi_config * spi,
+	const uint8_t * cmd, size_t len){
+	const struct ps2_gamepad_config *cfg = dev->config;
+	struct ps2_gamepad_data *data = dev->data;
+	if (cmd != data->tx){
+		memcpy(data->tx, cmd, len);
+	}
+	const struct spi_buf tx = {.buf = data->tx, .len = len};
+	const struct spi_buf rx = {.buf = data->rx, .len = len};
+	const struct spi_buf_set tx_set = {.buffers = &tx, .count = 1};
+	const struct spi_buf_set rx_set = {.buffers = &rx, .count = 1};
+	return spi_transceive(cfg->bus.bus, spi, &tx_set, &rx_set);
+}
+
+static inline bool ps2_reply_valid(const uint8_t * rx, uint8_t id){
+	return rx[1] == id && rx[2] == PS2_READY;
+}
+
+/**
+ * @brief Check that every one of CONFIG_PS2_GAMEPAD_PROBE_POLLS polls
+ * gets a valid reply in the same mode at the clock of `spi`.
+ *
+ * @retval 0 if the clock is reliable
+ * @retval -EIO otherwise
+ */
+static int ps2_probe(const struct device * dev, const struct spi_config * spi){
+	struct ps2_gamepad_data *data = dev->data;
+	uint8_t id = 0;
+	for (int i = 0; i < CONFIG_PS2_GAMEPAD_PROBE_POLLS; i++){
+		int rc = ps2_exchange(dev, spi, ps2_poll_cmd, PS2_DIGITAL_FRAME);
+		if (rc != 0){
+			return rc;
+		}
+		uint8_t reply = data->rx[1];
+		if (data->rx[2] != PS2_READY || (i > 0 && reply != id) ||
+			(reply != PS2_ID_DIGITAL && reply != PS2_ID_ANALOG && reply != PS2_ID_PRESSURE)){
+			return -EIO;
+		}
+		id = reply;
+	}
+	return 0;
+}
+
+/**
+ * @brief Find a reliable clock, then put the controller in the
+ * shortest reply mode which carries the controls we report.
+ *
+ * @param dev : pointer to device driver
+ * @param analog : whether the sticks are needed
+ * @retval 0 on success
+ * @retval -ENODEV if no controller answers at any clock
+ * @retval -errno otherwise
+ */
+static int ps2_attach(const struct device * dev, bool analog){
+	struct ps2_gamepad_data *data = dev->data;
+	const struct spi_config * spi = NULL;
+	data->spi = NULL;
+	data->last_valid = false;
+	for (int i = 0; i < data->nclocks; i++){
+		if (ps2_probe(dev, &data->clocks[i]) == 0){
+			spi = &data->clocks[i];
+			break;
+		}
+	}
+	if (spi == NULL){
+		return -ENODEV;
+	}
+	const uint8_t set_mode_cmd[PS2_MAX_FRAME] = {PS2_ADDR, PS2_CMD_SET_MODE, 0x00,
+		analog ? 0x01 : 0x00, PS2_MODE_LOCK};
+	const uint8_t * sequence[] = {ps2_enter_config_cmd, set_mode_cmd, ps2_exit_config_cmd};
+	for (int i = 0; i < ARRAY_SIZE(sequence); i++){
+		int rc = ps2_exchange(dev, spi, sequence[i], PS2_MAX_FRAME);
+		if (rc != 0){
+			return rc;
+		}
+		k_usleep(CONFIG_PS2_GAMEPAD_CONFIG_DELAY_US);
+	}
+	data->analog = analog;
+	data->mode_id = analog ? PS2_ID_ANALOG : PS2_ID_DIGITAL;
+	data->frame_len = analog ? PS2_ANALOG_FRAME : PS2_DIGITAL_FRAME;
+	/* The poll command never changes, so it is prepared once */
+	memcpy(data->tx, ps2_poll_cmd, data->frame_len);
+	int rc = ps2_exchange(dev, spi, data->tx, data->frame_len);
+	if (rc != 0){
+		return rc;
+	}
+	if (!ps2_reply_valid(data->rx, data->mode_id)){
+		LOG_WRN("%s: mode 0x%02x refused", dev->name, data->mode_id);
+		return -ENOTSUP;
+	}
+	data->spi = spi;
+	LOG_INF("%s: attached at %u Hz, %s mode", dev->name, spi->frequency,
+		analog ? "analog" : "digital");
+	return 0;
+}
+
+static int ps2_gamepad_read(const struct device * dev, const struct gamepad_layout * layout,
+	uint8_t * report, uint32_t * changed){
+	struct ps2_gamepad_data *data = dev->data;
+	bool analog = layout->axes > 0;
+	int rc;
+	if (data->spi == NULL || data->analog != analog){
+		/* Attaching probes every clock, so it is only attempted every so often */
+		if (data->spi == NULL && k_uptime_get() < data->next_attach){
+			return -ENODEV;
+		}
+		if ((rc = ps2_attach(dev, analog)) != 0){
+			data->next_attach = k_uptime_get() + CONFIG_PS2_GAMEPAD_ATTACH_INTERVAL_MS;
+			return rc;
+		}
+	}
+	rc = ps2_exchange(dev, data->spi, data->tx, data->frame_len);
+	if (rc == 0 && !ps2_reply_valid(data->rx, data->mode_id)){
+		rc = -EIO;
+	}
+	if (rc != 0){
+		/* Unplugged or reset: attach again on the next read */
+		data->spi = NULL;
+		return rc;
+	}
+
+	/* Buttons are active low */
+	uint16_t raw = ~(data->rx[3] | (data->rx[4] << 8));
+	uint32_t buttons = 0;
+	for (int i = 0; i < ARRAY_SIZE(ps2_buttons); i++){
+		if (raw & ps2_buttons[i]){
+			buttons |= BIT(i);
+		}
+	}
+	*changed = data->last_valid ? 0 : GAMEPAD_CHANGED_ALL;
+	if (buttons != data->last_buttons){
+		*changed |= GAMEPAD_CHANGED_BUTTONS;
+	}
+	data->last_buttons = buttons;
+
+	gamepad_report_clear(layout, report);
+	gamepad_report_set_buttons(layout, report, buttons);
+	if (analog){
+		/* Left x, left y, right x, right y */
+		static const uint8_t stick_bytes[PS2_AXES] = {7, 8, 5, 6};
+		for (int i = 0; i < PS2_AXES; i++){
+			uint8_t value = data->rx[stick_bytes[i]];
+			if (value != data->last_axes[i]){
+				*changed |= GAMEPAD_CHANGED_AXIS(i);
+			}
+			data->last_axes[i] = value;
+			gamepad_report_set_axis(layout, report, i, value, 8);
+		}
+	}
+	data->last_valid = true;
+	return 0;
+}
+
+/**
+ * @brief Prepare one bus configuration per candidate clock, halving from
+ * `spi-max-frequency` down to CONFIG_PS2_GAMEPAD_MIN_FREQUENCY. No bus
+ * traffic happens until the first read.
+ *
+ * @param dev : pointer to device driver
+ * @retval 0 on success
+ * @retval -ENODEV if the bus is not ready
+ */
+static int ps2_gamepad_init(const struct device * dev){
+	const struct ps2_gamepad_config *cfg = dev->config;
+	struct ps2_gamepad_data *data = dev->data;
+	if (!spi_is_ready(&cfg->bus)){
+		LOG_ERR("SPI bus for %s is not ready.", dev->name);
+		return -ENODEV;
+	}
+	uint32_t frequency = cfg->bus.config.frequency;
+	data->nclocks = 0;
+	do {
+		struct spi_config * clock = &data->clocks[data->nclocks++];
+		*clock = cfg->bus.config;
+		clock->frequency = frequency;
+		frequency /= 2;
+	} while (frequency >= CONFIG_PS2_GAMEPAD_MIN_FREQUENCY && data->nclocks < PS2_MAX_CLOCKS);
+	data->spi = NULL;
+	data->next_attach = 0;
+	return 0;
+}
+
+static const struct gamepad_driver_api ps2_gamepad_api_funcs = {
+	.read = ps2_gamepad_read,
+};
+
+#define PS2_GAMEPAD_DEFINE(inst) \
+	static struct ps2_gamepad_data ps2_gamepad_data_##inst; \
+	\
+	static const struct ps2_gamepad_config ps2_gamepad_cfg_##inst = { \
+		.bus = SPI_DT_SPEC_INST_GET(inst, PS2_SPI_OPERATION, 0), \
+	}; \
+	\
+	DEVICE_DT_INST_DEFINE(inst, ps2_gamepad_init, NULL, \
+			&ps2_gamepad_data_##inst, &ps2_gamepad_cfg_##inst, POST_KERNEL, \
+			CONFIG_APPLICATION_INIT_PRIORITY, &ps2_gamepad_api_funcs);
+
+DT_INST_FOREACH_STATUS_OKAY(PS2_GAMEPAD_DEFINE)
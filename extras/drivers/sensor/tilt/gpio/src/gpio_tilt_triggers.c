@@ -12,6 +12,7 @@
 #include <zephyr.h>
 #include "gpio_tilt.h"
 #include <logging/log.h>
+#include <tracing/tracing_shredlink.h>
 
 LOG_MODULE_DECLARE(tilt_gpio, CONFIG_SENSOR_LOG_LEVEL);
 
@@ -159,7 +160,9 @@ static void alert_cb(const struct device *dev, struct gpio_callback *cb,
 		CONTAINER_OF(cb, struct gpio_tilt_data, alert_cb);
 
 	ARG_UNUSED(pins);
+	SHREDLINK_TRACEPOINT_ENTER(TILT_ISR, pins);
 	prepare_int(data);
+	SHREDLINK_TRACEPOINT_EXIT(TILT_ISR, 0);
 }
 
 #ifdef CONFIG_TILT_SENSOR_TRIGGER_OWN_THREAD
@@ -13,7 +13,9 @@
 #define SHREDLINK_DRIVERS_SENSOR_NINTENDO_WII_H_
 
 #include <zephyr/types.h>
+#include <kernel.h>
 #include <device.h>
+#include <drivers/gamepad.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,9 +30,44 @@ struct wii_btn_data {
     uint8_t raw[6];
 };
 
+/**
+ * @brief A frame fetched by wii_peripheral_fetch_batch()
+ * 
+ */
+struct wii_frame {
+    struct wii_btn_data data;
+    /* Result of the fetch, data is only valid if 0 */
+    int err;
+    /* Cycle counter as the fetch started */
+    uint32_t cycles;
+};
+
+/**
+ * @brief Pads of a drum kit, in gamepad button order. Plus and minus
+ * follow the pads, and the velocity of each pad follows the stick axes.
+ * 
+ */
+enum wii_drum_pad {
+    WII_DRUM_GREEN,
+    WII_DRUM_RED,
+    WII_DRUM_YELLOW,
+    WII_DRUM_BLUE,
+    WII_DRUM_ORANGE,
+    WII_DRUM_BASS,
+    WII_DRUM_PADS
+};
+
 typedef int (*wii_periph_api_fetch)(const struct device *dev, struct wii_btn_data * data);
 
+/**
+ * @brief Wii peripheral driver API.
+ *
+ * Beside the raw frames, every wii peripheral with a known
+ * decoder can be read through the generic gamepad API.
+ *
+ */
 __subsystem struct wii_periph_driver_api {
+    struct gamepad_driver_api gamepad;
     wii_periph_api_fetch fetch;
 };
 
@@ -44,6 +81,38 @@ static inline int z_impl_wii_peripheral_fetch(const struct device *dev, struct w
 	return api->fetch(dev, data);
 }
 
+/**
+ * @brief Fetch a frame from each of `devs` in turn, in a single call.
+ * 
+ * From a user thread, this takes one kernel crossing and one copy of `frames`
+ * per batch rather than per frame. A device may be listed more than once,
+ * to read several frames back to back. A failed fetch does not stop the
+ * batch, its error is stored in its frame instead.
+ * 
+ * @param devs : devices to fetch from, one per frame
+ * @param frames : filled with one timestamped frame per device
+ * @param count : number of frames, at most CONFIG_WII_FETCH_BATCH_MAX
+ * @retval number of frames fetched successfully
+ */
+__syscall int wii_peripheral_fetch_batch(const struct device * const * devs,
+                                         struct wii_frame * frames, size_t count);
+
+static inline int z_impl_wii_peripheral_fetch_batch(const struct device * const * devs,
+                                                    struct wii_frame * frames, size_t count)
+{
+	int fetched = 0;
+	for (size_t i = 0; i < count; i++){
+		const struct wii_periph_driver_api *api =
+				(struct wii_periph_driver_api *)devs[i]->api;
+		frames[i].cycles = k_cycle_get_32();
+		frames[i].err = api->fetch(devs[i], &frames[i].data);
+		if (frames[i].err == 0){
+			fetched++;
+		}
+	}
+	return fetched;
+}
+
 #ifdef __cplusplus
 }
 #endif
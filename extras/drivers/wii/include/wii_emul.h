@@ -0,0 +1,136 @@
+/**
+ * @file wii_emul.h
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Control of emulated wii peripherals on an emulated i2c bus
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (C) 2026 Brian Bradley
+ * 
+ * SPDX-License-Identifier: Apache-2.0
+ * 
+ */
+
+#ifndef SHREDLINK_DRIVERS_NINTENDO_WII_EMUL_H_
+#define SHREDLINK_DRIVERS_NINTENDO_WII_EMUL_H_
+
+#include <drivers/emul.h>
+#include <wii.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bus activity addressed to an emulated peripheral
+ * 
+ */
+struct wii_emul_stats {
+    /* i2c transactions, from start to stop condition */
+    uint32_t transactions;
+    uint32_t bytes;
+    /* Time the transactions took on the wire, at the clock of the bus */
+    uint64_t bus_ns;
+    /* Time from selecting a register to reading it, left idle on the wire
+    while the peripheral gets the data ready. Add bus_ns for the time a
+    fetch takes from start to end. */
+    uint64_t wait_ns;
+    /* Reads which came before the data was ready */
+    uint32_t not_ready;
+};
+
+/**
+ * @brief Set the raw frame the emulated peripheral returns on the next data read
+ * 
+ * @param target : emulator, as returned by `emul_get_binding()`
+ * @param frame : raw frame, in the format the physical peripheral sends it
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+int wii_emul_set_frame(const struct emul *target, const struct wii_btn_data * frame);
+
+/**
+ * @brief Plug or unplug the emulated peripheral. While unplugged, every
+ * transfer addressed to it fails as if the peripheral did not acknowledge.
+ * 
+ * @param target : emulator, as returned by `emul_get_binding()`
+ * @param connected : true to plug the peripheral in
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+int wii_emul_set_connected(const struct emul *target, bool connected);
+
+/**
+ * @brief Set the time data takes to be ready after a register is selected.
+ * Reads before then return a frame of 0xff, as the bus is left high.
+ * 
+ * @param target : emulator, as returned by `emul_get_binding()`
+ * @param delay_us : 0 for a peripheral which answers in the same transaction
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+int wii_emul_set_data_ready(const struct emul *target, uint32_t delay_us);
+
+/**
+ * @brief Move the whammy bar of an emulated guitar on every data read, so
+ * that each read returns a frame which differs from the previous one.
+ * 
+ * @param target : emulator, as returned by `emul_get_binding()`
+ * @param sweep : true to start moving the whammy bar, false to leave it where it is
+ * @retval 0 on success
+ * @retval -ENOTSUP if the emulator is not a guitar
+ * @retval -errno otherwise
+ */
+int wii_emul_set_sweep(const struct emul *target, bool sweep);
+
+int wii_emul_get_stats(const struct emul *target, struct wii_emul_stats *stats);
+
+int wii_emul_reset_stats(const struct emul *target);
+
+/**
+ * @brief Peripherals the emulator can pretend to be
+ * 
+ */
+enum wii_emul_type {
+    WII_EMUL_GUITAR,
+    WII_EMUL_DRUMS,
+};
+
+/**
+ * @brief Change the emulated peripheral. Its controls are released and
+ * queued hits are discarded. The driver only notices after a read fails,
+ * e.g. while the peripheral is unplugged.
+ * 
+ * @param target : emulator, as returned by `emul_get_binding()`
+ * @param type : peripheral to emulate
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+int wii_emul_set_type(const struct emul *target, enum wii_emul_type type);
+
+/**
+ * @brief Hit a pad of an emulated drum kit. Hits are queued, and each data
+ * read sends the oldest one.
+ * 
+ * @param target : emulator, as returned by `emul_get_binding()`
+ * @param pad : pad hit
+ * @param velocity : from 0 (softest) to 7 (hardest)
+ * @retval 0 on success
+ * @retval -ENOSPC if CONFIG_WII_EMUL_DRUM_QUEUE hits are queued already, the hit is lost
+ * @retval -ENOTSUP if the emulator is not a drum kit
+ * @retval -errno otherwise
+ */
+int wii_emul_drum_hit(const struct emul *target, enum wii_drum_pad pad, uint8_t velocity);
+
+/**
+ * @brief Number of hits queued by an emulated drum kit which were not read yet
+ * 
+ * @param target : emulator, as returned by `emul_get_binding()`
+ * @retval hits queued, or -errno
+ */
+int wii_emul_drum_pending(const struct emul *target);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
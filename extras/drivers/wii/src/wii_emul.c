@@ -0,0 +1,441 @@
+/**
+ * @file wii_emul.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Emulated wii guitar or drum kit, attached to an emulated i2c controller.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#define DT_DRV_COMPAT nintendo_wii
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/emul.h>
+#include <drivers/i2c.h>
+#include <drivers/i2c_emul.h>
+#include <logging/log.h>
+#include <wii.h>
+#include <wii_emul.h>
+
+LOG_MODULE_REGISTER(wii_emul, CONFIG_WII_LOG_LEVEL);
+
+#define WII_REG_DATA	0x00
+#define WII_REG_ID		0xfa
+
+/* Identification bytes of a GH3 / GHWT guitar, as read from WII_REG_ID */
+static const uint8_t wii_guitar_id[6] = {0x00, 0x00, 0xa4, 0x20, 0x01, 0x03};
+/* Identification bytes of a GHWT drum kit */
+static const uint8_t wii_drums_id[6] = {0x01, 0x00, 0xa4, 0x20, 0x01, 0x03};
+
+/**
+ * @brief Guitar at rest: sticks centered, whammy released and every
+ * button released (buttons are active low).
+ */
+static const struct wii_btn_data wii_guitar_idle = {
+	.raw = {0x20, 0x20, 0x00, 0x10, 0xff, 0xff}
+};
+
+/**
+ * @brief Drum kit at rest: stick centered, no velocity event and every
+ * pad and button released (active low).
+ */
+static const struct wii_btn_data wii_drums_idle = {
+	.raw = {0x20, 0x20, 0xff, 0xff, 0xff, 0xff}
+};
+
+/* `which` field of a velocity event, and pad bit in byte 5, of each pad */
+static const struct {
+	uint8_t which;
+	uint8_t bit;
+} wii_drums_pads[WII_DRUM_PADS] = {
+	[WII_DRUM_GREEN] = {0x12, 4},
+	[WII_DRUM_RED] = {0x19, 6},
+	[WII_DRUM_YELLOW] = {0x11, 5},
+	[WII_DRUM_BLUE] = {0x0f, 3},
+	[WII_DRUM_ORANGE] = {0x0e, 7},
+	[WII_DRUM_BASS] = {0x1b, 2},
+};
+
+struct wii_emul_hit {
+	uint8_t pad;
+	uint8_t velocity;
+};
+
+/**
+ * @brief Run time data of an emulated peripheral
+ *
+ */
+struct wii_emul_data {
+	struct i2c_emul emul_i2c;
+	const struct wii_emul_cfg *cfg;
+	struct k_spinlock lock;
+	struct wii_btn_data frame;
+	enum wii_emul_type type;
+	/* Hits not read yet, drum kits only */
+	struct wii_emul_hit hits[CONFIG_WII_EMUL_DRUM_QUEUE];
+	uint8_t hit_head;
+	uint8_t hit_count;
+	uint8_t reg;
+	/* When the register was selected (cycles), and how long until its data is ready */
+	uint32_t reg_cycles;
+	/* The selected register was not read yet */
+	bool reg_selected;
+	uint32_t data_ready_us;
+	bool connected;
+	/* Move the whammy bar on every data read, guitars only */
+	bool sweep;
+	struct wii_emul_stats stats;
+};
+
+/**
+ * @brief Static configuration of an emulated peripheral
+ *
+ */
+struct wii_emul_cfg {
+	struct wii_emul_data *data;
+	uint16_t addr;
+	/* Clock of the bus, to account for the time transactions take on the wire */
+	uint32_t bus_frequency;
+};
+
+int wii_emul_set_frame(const struct emul *target, const struct wii_btn_data * frame){
+	if (target == NULL || frame == NULL){
+		return -EINVAL;
+	}
+	const struct wii_emul_cfg *cfg = target->cfg;
+	struct wii_emul_data *data = cfg->data;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+	data->frame = *frame;
+	k_spin_unlock(&data->lock, key);
+	return 0;
+}
+
+int wii_emul_set_connected(const struct emul *target, bool connected){
+	if (target == NULL){
+		return -EINVAL;
+	}
+	const struct wii_emul_cfg *cfg = target->cfg;
+	cfg->data->connected = connected;
+	return 0;
+}
+
+int wii_emul_set_data_ready(const struct emul *target, uint32_t delay_us){
+	if (target == NULL){
+		return -EINVAL;
+	}
+	const struct wii_emul_cfg *cfg = target->cfg;
+	cfg->data->data_ready_us = delay_us;
+	return 0;
+}
+
+int wii_emul_get_stats(const struct emul *target, struct wii_emul_stats *stats){
+	if (target == NULL || stats == NULL){
+		return -EINVAL;
+	}
+	const struct wii_emul_cfg *cfg = target->cfg;
+	*stats = cfg->data->stats;
+	return 0;
+}
+
+int wii_emul_reset_stats(const struct emul *target){
+	if (target == NULL){
+		return -EINVAL;
+	}
+	const struct wii_emul_cfg *cfg = target->cfg;
+	memset(&cfg->data->stats, 0, sizeof(cfg->data->stats));
+	return 0;
+}
+
+/**
+ * @brief Account for the time a transaction takes on the wire: a start
+ * condition and an address byte for every direction change or repeated
+ * start, 9 clocks per byte (with the acknowledge), and the stop condition
+ * followed by the bus free time (a clock each).
+ *
+ */
+static void wii_emul_account(const struct wii_emul_cfg *cfg, struct i2c_msg *msgs, int num_msgs){
+	struct wii_emul_stats *stats = &cfg->data->stats;
+	uint32_t clocks = 2;
+	for (int i = 0; i < num_msgs; i++){
+		struct i2c_msg *msg = &msgs[i];
+		if (i == 0 || (msg->flags & I2C_MSG_RESTART) ||
+			((msg->flags ^ msgs[i - 1].flags) & I2C_MSG_RW_MASK)){
+			clocks += 1 + 9;
+		}
+		clocks += 9 * msg->len;
+		stats->bytes += msg->len;
+	}
+	stats->transactions++;
+	stats->bus_ns += (uint64_t)clocks * NSEC_PER_SEC / cfg->bus_frequency;
+}
+
+int wii_emul_set_type(const struct emul *target, enum wii_emul_type type){
+	if (target == NULL || (type != WII_EMUL_GUITAR && type != WII_EMUL_DRUMS)){
+		return -EINVAL;
+	}
+	const struct wii_emul_cfg *cfg = target->cfg;
+	struct wii_emul_data *data = cfg->data;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+	data->type = type;
+	data->frame = (type == WII_EMUL_DRUMS) ? wii_drums_idle : wii_guitar_idle;
+	data->hit_head = 0;
+	data->hit_count = 0;
+	data->sweep = false;
+	k_spin_unlock(&data->lock, key);
+	return 0;
+}
+
+int wii_emul_set_sweep(const struct emul *target, bool sweep){
+	if (target == NULL){
+		return -EINVAL;
+	}
+	const struct wii_emul_cfg *cfg = target->cfg;
+	struct wii_emul_data *data = cfg->data;
+	int rc = 0;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+	if (data->type != WII_EMUL_GUITAR){
+		rc = -ENOTSUP;
+	}
+	else{
+		data->sweep = sweep;
+	}
+	k_spin_unlock(&data->lock, key);
+	return rc;
+}
+
+int wii_emul_drum_hit(const struct emul *target, enum wii_drum_pad pad, uint8_t velocity){
+	if (target == NULL || pad >= WII_DRUM_PADS || velocity > 7){
+		return -EINVAL;
+	}
+	const struct wii_emul_cfg *cfg = target->cfg;
+	struct wii_emul_data *data = cfg->data;
+	int rc = 0;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+	if (data->type != WII_EMUL_DRUMS){
+		rc = -ENOTSUP;
+	}
+	else if (data->hit_count == CONFIG_WII_EMUL_DRUM_QUEUE){
+		rc = -ENOSPC;
+	}
+	else {
+		uint8_t tail = (data->hit_head + data->hit_count) % CONFIG_WII_EMUL_DRUM_QUEUE;
+		data->hits[tail] = (struct wii_emul_hit){.pad = pad, .velocity = velocity};
+		data->hit_count++;
+	}
+	k_spin_unlock(&data->lock, key);
+	return rc;
+}
+
+int wii_emul_drum_pending(const struct emul *target){
+	if (target == NULL){
+		return -EINVAL;
+	}
+	const struct wii_emul_cfg *cfg = target->cfg;
+	return cfg->data->hit_count;
+}
+
+/**
+ * @brief Build the next data frame. Drum kits send the oldest queued hit
+ * along with the current controls: its pad is pressed and the velocity
+ * event fields are filled.
+ *
+ */
+static void wii_emul_next_frame(struct wii_emul_data *data, uint8_t * raw){
+	if (data->sweep){
+		/* Whammy is the low 5 bits of byte 3 */
+		data->frame.raw[3] = (data->frame.raw[3] & ~0x1f) | ((data->frame.raw[3] + 1) & 0x1f);
+	}
+	memcpy(raw, data->frame.raw, sizeof(data->frame.raw));
+	if (data->type != WII_EMUL_DRUMS || data->hit_count == 0){
+		return;
+	}
+	const struct wii_emul_hit *hit = &data->hits[data->hit_head];
+	data->hit_head = (data->hit_head + 1) % CONFIG_WII_EMUL_DRUM_QUEUE;
+	data->hit_count--;
+	/* Clear `none` and set `which`, softness goes from 0 (hardest) to 7 */
+	raw[2] = 0x81 | (wii_drums_pads[hit->pad].which << 1);
+	raw[3] = ((7 - hit->velocity) << 5) | 0x1f;
+	raw[5] &= ~BIT(wii_drums_pads[hit->pad].bit);
+}
+
+/**
+ * @brief Handle the i2c messages addressed to the emulated peripheral.
+ *
+ * A write of a single byte selects the register to read from. Writes
+ * of two bytes are the (unencrypted) init sequence and are accepted.
+ *
+ * @retval 0 on success
+ * @retval -EIO if the peripheral is unplugged or the access is not supported
+ */
+static int wii_emul_transfer(struct i2c_emul *emul, struct i2c_msg *msgs,
+				int num_msgs, int addr)
+{
+	struct wii_emul_data *data = CONTAINER_OF(emul, struct wii_emul_data, emul_i2c);
+	const struct wii_emul_cfg *cfg = data->cfg;
+	if (!data->connected){
+		return -EIO;
+	}
+	wii_emul_account(cfg, msgs, num_msgs);
+	for (int i = 0; i < num_msgs; i++){
+		struct i2c_msg *msg = &msgs[i];
+		if (msg->flags & I2C_MSG_READ){
+			if (msg->len > sizeof(data->frame.raw)){
+				return -EIO;
+			}
+			if (data->reg_selected){
+				data->stats.wait_ns += k_cyc_to_ns_floor64(k_cycle_get_32() - data->reg_cycles);
+				data->reg_selected = false;
+			}
+			if (k_cyc_to_us_floor32(k_cycle_get_32() - data->reg_cycles) < data->data_ready_us){
+				/* Nothing drives the bus yet, it reads high */
+				memset(msg->buf, 0xff, msg->len);
+				data->stats.not_ready++;
+			}
+			else if (data->reg == WII_REG_ID){
+				memcpy(msg->buf, (data->type == WII_EMUL_DRUMS) ?
+					wii_drums_id : wii_guitar_id, msg->len);
+			}
+			else if (data->reg == WII_REG_DATA){
+				uint8_t raw[sizeof(data->frame.raw)];
+				k_spinlock_key_t key = k_spin_lock(&data->lock);
+				wii_emul_next_frame(data, raw);
+				k_spin_unlock(&data->lock, key);
+				memcpy(msg->buf, raw, msg->len);
+			}
+			else{
+				return -EIO;
+			}
+		}
+		else{
+			if (msg->len < 1 || msg->len > 2){
+				return -EIO;
+			}
+			data->reg = msg->buf[0];
+			data->reg_cycles = k_cycle_get_32();
+			data->reg_selected = true;
+		}
+	}
+	return 0;
+}
+
+static const struct i2c_emul_api wii_emul_api_i2c = {
+	.transfer = wii_emul_transfer,
+};
+
+static int wii_emul_init(const struct emul *emul, const struct device *parent)
+{
+	const struct wii_emul_cfg *cfg = emul->cfg;
+	struct wii_emul_data *data = cfg->data;
+
+	data->emul_i2c.api = &wii_emul_api_i2c;
+	data->emul_i2c.addr = cfg->addr;
+	data->cfg = cfg;
+	data->type = WII_EMUL_GUITAR;
+	data->frame = wii_guitar_idle;
+	data->data_ready_us = CONFIG_WII_EMUL_DATA_READY_US;
+	data->connected = true;
+	return i2c_emul_register(parent, emul->dev_label, &data->emul_i2c);
+}
+
+#define WII_EMUL(n) \
+	static struct wii_emul_data wii_emul_data_##n; \
+	static const struct wii_emul_cfg wii_emul_cfg_##n = { \
+		.data = &wii_emul_data_##n, \
+		.addr = DT_INST_REG_ADDR(n), \
+		.bus_frequency = DT_PROP_OR(DT_INST_BUS(n), clock_frequency, \
+			I2C_BITRATE_STANDARD), \
+	}; \
+	EMUL_DEFINE(wii_emul_init, DT_DRV_INST(n), &wii_emul_cfg_##n)
+
+DT_INST_FOREACH_STATUS_OKAY(WII_EMUL)
+
+#ifdef CONFIG_WII_EMUL_SHELL
+#include <shell/shell.h>
+#include <stdlib.h>
+
+static const struct emul *shell_get_emul(const struct shell *sh, const char *label){
+	const struct emul *target = emul_get_binding(label);
+	if (target == NULL){
+		shell_error(sh, "no emulator named %s", label);
+	}
+	return target;
+}
+
+static int cmd_frame(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct emul *target = shell_get_emul(sh, argv[1]);
+	struct wii_btn_data frame;
+	if (target == NULL){
+		return -ENODEV;
+	}
+	for (int i = 0; i < sizeof(frame.raw); i++){
+		frame.raw[i] = (uint8_t)strtoul(argv[i + 2], NULL, 16);
+	}
+	return wii_emul_set_frame(target, &frame);
+}
+
+static int cmd_plug(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct emul *target = shell_get_emul(sh, argv[1]);
+	if (target == NULL){
+		return -ENODEV;
+	}
+	return wii_emul_set_connected(target, strtoul(argv[2], NULL, 10) != 0);
+}
+
+static int cmd_type(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct emul *target = shell_get_emul(sh, argv[1]);
+	if (target == NULL){
+		return -ENODEV;
+	}
+	if (strcmp(argv[2], "guitar") == 0){
+		return wii_emul_set_type(target, WII_EMUL_GUITAR);
+	}
+	if (strcmp(argv[2], "drums") == 0){
+		return wii_emul_set_type(target, WII_EMUL_DRUMS);
+	}
+	shell_error(sh, "unknown type %s", argv[2]);
+	return -EINVAL;
+}
+
+static int cmd_hit(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct emul *target = shell_get_emul(sh, argv[1]);
+	if (target == NULL){
+		return -ENODEV;
+	}
+	int rc = wii_emul_drum_hit(target, strtoul(argv[2], NULL, 10),
+		strtoul(argv[3], NULL, 10));
+	if (rc == -ENOSPC){
+		shell_warn(sh, "hit queue full, hit lost");
+	}
+	return rc;
+}
+
+static int cmd_sweep(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct emul *target = shell_get_emul(sh, argv[1]);
+	if (target == NULL){
+		return -ENODEV;
+	}
+	return wii_emul_set_sweep(target, strtoul(argv[2], NULL, 10) != 0);
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_wii_emul,
+	SHELL_CMD_ARG(frame, NULL, "<label> <6 raw bytes in hex>", cmd_frame, 8, 0),
+	SHELL_CMD_ARG(plug, NULL, "<label> <0|1>", cmd_plug, 3, 0),
+	SHELL_CMD_ARG(type, NULL, "<label> <guitar|drums>", cmd_type, 3, 0),
+	SHELL_CMD_ARG(hit, NULL, "<label> <pad 0-5> <velocity 0-7>", cmd_hit, 4, 0),
+	SHELL_CMD_ARG(sweep, NULL, "<label> <0|1>", cmd_sweep, 3, 0),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(wii_emul, &sub_wii_emul, "Emulated wii peripherals", NULL);
+#endif /* CONFIG_WII_EMUL_SHELL */
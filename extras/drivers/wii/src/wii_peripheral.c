@@ -19,6 +19,9 @@
 #include <init.h>
 #include <sys/__assert.h>
 #include <logging/log.h>
+#include <pm/device.h>
+#include <pm/device_runtime.h>
+#include <tracing/tracing_shredlink.h>
 #include <wii.h>
 #include <sys/byteorder.h>
 
@@ -34,13 +37,36 @@ typedef enum WiiTypes{
 	WII_TURNTABLE,
 }wii_type_t;
 
+#define WII_MAX_AXES	8
+/* Buttons which may be latched, see `struct wii_peripheral` */
+#define WII_MAX_LATCHED	8
+
+/**
+ * @brief State of the controls of a peripheral, decoded from a raw
+ * frame. Buttons are active high.
+ */
+struct wii_gamepad_state{
+	uint32_t buttons;
+	uint8_t axes[WII_MAX_AXES];
+};
+
 /**
  * @brief Data associated with a specific peripheral implementation.
  */
 struct wii_peripheral{
 	wii_type_t peripheral;
-	uint64_t id; /* This is the decrypted id, so the data stream must first be unencrypted before matching */
+	uint64_t id; /* Decrypted 48 bit id, read big endian, so the data stream must first be unencrypted before matching */
 	const char * label;
+	/* Decoder used by the gamepad API, NULL if the peripheral is not supported there */
+	void (*decode)(const struct wii_btn_data * frame, struct wii_gamepad_state * state);
+	/* Whether more events are queued after this frame, NULL if the peripheral has no queue */
+	bool (*pending)(const struct wii_btn_data * frame);
+	/* Latched buttons hit by the event of this frame, if it carries one */
+	uint32_t (*hit)(const struct wii_btn_data * frame);
+	/* Momentary buttons (hits), held for CONFIG_WII_HIT_HOLD_US once seen */
+	uint32_t latched;
+	uint8_t axes;
+	uint8_t axis_bits[WII_MAX_AXES];
 };
 
 /**
@@ -50,6 +76,23 @@ struct wii_peripheral{
 struct wii_periph_data {
 	struct wii_btn_data wii;
 	const struct wii_peripheral * peripheral;
+	/* Last state read through the gamepad API, used to build the change mask */
+	struct wii_gamepad_state state;
+	bool state_valid;
+	/* Latched buttons pressed in the last report, and when each was last seen (cycles) */
+	uint32_t held;
+	uint32_t hit_time[WII_MAX_LATCHED];
+	/* Frames are fetched in a single transaction, see wii_read_data_combined() */
+	bool combined;
+	/* Events read while probing, returned by the next fetches (see wii_probe_combined()) */
+	struct wii_btn_data probed[CONFIG_WII_COMBINED_FETCH_PROBES];
+	uint8_t probed_count;
+	uint8_t probed_next;
+	/* Frame held back by the last read, returned by the next fetch (see wii_periph_read()) */
+	struct wii_btn_data deferred;
+	bool deferred_valid;
+	/* Uptime (ms) before which discovery is not attempted again */
+	int64_t next_discovery;
 };
 
 /**
@@ -66,16 +109,199 @@ struct cmd_seq_item {
 	const uint8_t data;
 };
 
+struct __attribute__((packed)) guitar_data{
+	uint8_t analog_x: 6;
+	uint8_t gh0: 2;
+	uint8_t analog_y: 6;
+	uint8_t gh1: 2;
+	uint8_t touchbar: 5;
+	uint8_t empty0: 3;
+	uint8_t whammy: 5;
+	uint8_t empty1: 3;
+	uint8_t empty2: 2;
+	uint8_t button_plus: 1;
+	uint8_t empty3: 1;
+	uint8_t button_minus: 1;
+	uint8_t empty4: 1;
+	uint8_t strum_down: 1;
+	uint8_t empty5: 1;
+	uint8_t strum_up: 1;
+	uint8_t empty6: 2;
+	uint8_t neck: 5;
+};
+
+struct __attribute__((packed)) drums_data{
+	uint8_t analog_x: 6;
+	uint8_t empty0: 2;
+	uint8_t analog_y: 6;
+	uint8_t empty1: 2;
+	uint8_t empty2: 1;
+	uint8_t which: 5;
+	uint8_t none: 1;
+	uint8_t hhp: 1;
+	uint8_t empty3: 5;
+	uint8_t softness: 3;
+	uint8_t empty4: 2;
+	uint8_t button_plus: 1;
+	uint8_t empty5: 1;
+	uint8_t button_minus: 1;
+	uint8_t empty6: 3;
+	uint8_t empty7: 2;
+	uint8_t bass: 1;
+	uint8_t blue: 1;
+	uint8_t green: 1;
+	uint8_t yellow: 1;
+	uint8_t red: 1;
+	uint8_t orange: 1;
+};
+
+/**
+ * @brief This union is a conveient container which allows
+ * easily converting between raw frame data, and useful
+ * gamepad data without needing to mask and shift everything
+ * manually.
+ * 
+ */
+typedef union wii_data_fmt{
+	struct wii_btn_data frame;
+	struct guitar_data guitar;
+	struct drums_data drums;
+}wii_fmt_t;
+
+/**
+ * @brief Guitar buttons, in gamepad order: the five frets, plus,
+ * minus, strum up and strum down. Axes are the stick (x, y) and
+ * the whammy bar.
+ * 
+ * @param frame : raw data frame
+ * @param state : decoded controls
+ */
+static void wii_guitar_decode(const struct wii_btn_data * frame, struct wii_gamepad_state * state){
+	wii_fmt_t fmt = {
+		.frame = *frame
+	};
+	uint32_t buttons = fmt.guitar.neck;
+	WRITE_BIT(buttons, 5, fmt.guitar.button_plus);
+	WRITE_BIT(buttons, 6, fmt.guitar.button_minus);
+	WRITE_BIT(buttons, 7, fmt.guitar.strum_up);
+	WRITE_BIT(buttons, 8, fmt.guitar.strum_down);
+	/* Buttons are active low */
+	state->buttons = ~buttons & BIT_MASK(9);
+	state->axes[0] = fmt.guitar.analog_x;
+	state->axes[1] = fmt.guitar.analog_y;
+	state->axes[2] = fmt.guitar.whammy;
+}
+
+/* Value of `which` in a drum frame, for each pad in gamepad order */
+static const uint8_t wii_drums_which[] = {
+	[WII_DRUM_GREEN] = 0x12,
+	[WII_DRUM_RED] = 0x19,
+	[WII_DRUM_YELLOW] = 0x11,
+	[WII_DRUM_BLUE] = 0x0f,
+	[WII_DRUM_ORANGE] = 0x0e,
+	[WII_DRUM_BASS] = 0x1b,
+};
+
+/**
+ * @brief Pad of the velocity event of a drum kit frame
+ *
+ * @retval pad (see `enum wii_drum_pad`)
+ * @retval -1 if the frame carries no event, or one of an unknown pad
+ */
+static int wii_drums_event_pad(const wii_fmt_t * fmt){
+	if (fmt->drums.none){
+		return -1;
+	}
+	for (int pad = 0; pad < ARRAY_SIZE(wii_drums_which); pad++){
+		if (wii_drums_which[pad] == fmt->drums.which){
+			return pad;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Drum kit buttons, in gamepad order: the pads (see `enum wii_drum_pad`),
+ * plus and minus. Axes are the stick (x, y) followed by the velocity of
+ * each pad, from 0 (softest, or never hit) to 7 (hardest).
+ *
+ * Hits are accumulated into `state`, so that a burst of frames reports every
+ * pad hit during the burst. A frame carries at most one velocity event.
+ *
+ * @param frame : raw data frame
+ * @param state : decoded controls
+ */
+static void wii_drums_decode(const struct wii_btn_data * frame, struct wii_gamepad_state * state){
+	wii_fmt_t fmt = {
+		.frame = *frame
+	};
+	/* Pads and buttons are active low */
+	uint32_t buttons = 0;
+	WRITE_BIT(buttons, WII_DRUM_GREEN, !fmt.drums.green);
+	WRITE_BIT(buttons, WII_DRUM_RED, !fmt.drums.red);
+	WRITE_BIT(buttons, WII_DRUM_YELLOW, !fmt.drums.yellow);
+	WRITE_BIT(buttons, WII_DRUM_BLUE, !fmt.drums.blue);
+	WRITE_BIT(buttons, WII_DRUM_ORANGE, !fmt.drums.orange);
+	WRITE_BIT(buttons, WII_DRUM_BASS, !fmt.drums.bass);
+	int pad = wii_drums_event_pad(&fmt);
+	if (pad >= 0){
+		/* Softness goes from 0 (hardest) to 7 */
+		buttons |= BIT(pad);
+		state->axes[2 + pad] = 7 - fmt.drums.softness;
+	}
+	state->buttons |= buttons;
+	WRITE_BIT(state->buttons, WII_DRUM_PADS, !fmt.drums.button_plus);
+	WRITE_BIT(state->buttons, WII_DRUM_PADS + 1, !fmt.drums.button_minus);
+	state->axes[0] = fmt.drums.analog_x;
+	state->axes[1] = fmt.drums.analog_y;
+}
+
+/**
+ * @brief Drum kits queue velocity events and send one per frame. Another
+ * may follow as long as frames carry one.
+ *
+ */
+static bool wii_drums_pending(const struct wii_btn_data * frame){
+	wii_fmt_t fmt = {
+		.frame = *frame
+	};
+	return !fmt.drums.none;
+}
+
+static uint32_t wii_drums_hit(const struct wii_btn_data * frame){
+	wii_fmt_t fmt = {
+		.frame = *frame
+	};
+	int pad = wii_drums_event_pad(&fmt);
+	return (pad >= 0) ? BIT(pad) : 0;
+}
+
 #define DEFINE_WII_PERIPHERAL(_tag, _id, _label)	\
-	{.peripheral = _tag, .id = (__bswap_48((uint64_t)_id)), .label=_label}
+	{.peripheral = _tag, .id = (uint64_t)(_id), .label=_label}
+
+/* A peripheral which can be read through the gamepad API, with the resolution of each axis */
+#define DEFINE_WII_GAMEPAD(_tag, _id, _label, _decode, ...)	\
+	{.peripheral = _tag, .id = (uint64_t)(_id), .label=_label, \
+	 .decode = _decode, .axes = NUM_VA_ARGS_LESS_1(_, __VA_ARGS__), .axis_bits = {__VA_ARGS__}}
+
+/* A gamepad which queues events, and whose `_latched` buttons are momentary hits */
+#define DEFINE_WII_QUEUED_GAMEPAD(_tag, _id, _label, _decode, _pending, _hit, _latched, ...)	\
+	{.peripheral = _tag, .id = (uint64_t)(_id), .label=_label, \
+	 .decode = _decode, .pending = _pending, .hit = _hit, .latched = _latched, \
+	 .axes = NUM_VA_ARGS_LESS_1(_, __VA_ARGS__), .axis_bits = {__VA_ARGS__}}
 
 const struct wii_peripheral wii_peripheral_table[] = {
 	DEFINE_WII_PERIPHERAL(WII_CLASSIC, 0xa4200101, "Wii Classic Controller"),
 	DEFINE_WII_PERIPHERAL(WII_NUNCHUK, 0xa4200000, "Wii Nunchuk"),
 	DEFINE_WII_PERIPHERAL(WII_CLASSIC_PRO, 0x0100a4200101, "Wii Classic Controller Pro / SNES controller"),
-	DEFINE_WII_PERIPHERAL(WII_GUITAR, 0xa4200103, "Wii GH3 / GHWT Guitar")
+	DEFINE_WII_GAMEPAD(WII_GUITAR, 0xa4200103, "Wii GH3 / GHWT Guitar", wii_guitar_decode, 6, 6, 5),
+	DEFINE_WII_QUEUED_GAMEPAD(WII_DRUMS, 0x0100a4200103, "Wii GHWT Drums", wii_drums_decode,
+		wii_drums_pending, wii_drums_hit, BIT_MASK(WII_DRUM_PADS), 6, 6, 3, 3, 3, 3, 3, 3)
 };
 
+BUILD_ASSERT(WII_DRUM_PADS <= WII_MAX_LATCHED, "drum pads must fit in the latched buttons");
+
+
 /**
  * @brief Configure the i2c bus for communication with the wii peripheral.
  * 
@@ -104,7 +330,10 @@ static inline int wii_bus_config(const struct device *dev)
  */
 static int wii_read_data_slow(const struct i2c_dt_spec * i2c, uint8_t reg, uint8_t * data, uint8_t len){
 	int rc = 0;
-	if ((rc = i2c_write_dt(i2c, &reg, sizeof(reg))) != 0){
+	SHREDLINK_TRACEPOINT_ENTER(I2C_WRITE, reg);
+	rc = i2c_write_dt(i2c, &reg, sizeof(reg));
+	SHREDLINK_TRACEPOINT_EXIT(I2C_WRITE, rc);
+	if (rc != 0){
 			return rc;
 	}
 	/**
@@ -117,8 +346,75 @@ static int wii_read_data_slow(const struct i2c_dt_spec * i2c, uint8_t reg, uint8
 	 * option for the return to be scheduled (and possible delayed).
 	 * 
 	 */
+	SHREDLINK_TRACEPOINT_ENTER(DATA_READY_WAIT, CONFIG_WII_WRITE_READ_DELAY_US);
 	k_busy_wait(CONFIG_WII_WRITE_READ_DELAY_US);
-	return i2c_read_dt(i2c, data, 6);
+	SHREDLINK_TRACEPOINT_EXIT(DATA_READY_WAIT, 0);
+	SHREDLINK_TRACEPOINT_ENTER(I2C_READ, len);
+	rc = i2c_read_dt(i2c, data, 6);
+	SHREDLINK_TRACEPOINT_EXIT(I2C_READ, rc);
+	return rc;
+}
+
+/**
+ * @brief Perform a data read at the specified register (`reg`) in a single
+ * transaction: the register write and the read are joined by a repeated
+ * start, without waiting for data to be ready in between. Only some
+ * (third party) peripherals have data ready that quickly.
+ * 
+ * @param i2c : i2c bus spec
+ * @param reg : register to write before reading data back
+ * @param data : buffer to place data into
+ * @param len : length of data to read back
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+static int wii_read_data_combined(const struct i2c_dt_spec * i2c, uint8_t reg, uint8_t * data, uint8_t len){
+	SHREDLINK_TRACEPOINT_ENTER(I2C_READ, len);
+	int rc = i2c_write_read_dt(i2c, &reg, sizeof(reg), data, len);
+	SHREDLINK_TRACEPOINT_EXIT(I2C_READ, rc);
+	return rc;
+}
+
+/**
+ * @brief Whether a data frame holds data. A peripheral which had no
+ * data ready leaves the bus high (or low) during the read.
+ * 
+ */
+static bool wii_frame_valid(const struct wii_btn_data * frame){
+	bool high = true;
+	bool low = true;
+	for (int i = 0; i < sizeof(frame->raw); i++){
+		high &= frame->raw[i] == 0xff;
+		low &= frame->raw[i] == 0x00;
+	}
+	return !high && !low;
+}
+
+/**
+ * @brief Check whether the attached peripheral has data ready for
+ * single transaction fetches.
+ * 
+ * Peripherals which queue events (drum kits) dequeue one per frame read,
+ * so the frames carrying one are kept, to be returned by the next fetches.
+ * 
+ * @param dev : pointer to device driver
+ * @retval true if every probe read returned a valid frame
+ */
+static bool wii_probe_combined(const struct device *dev){
+	const struct wii_periph_config *cfg = dev->config;
+	struct wii_periph_data * data = dev->data;
+	const struct wii_peripheral * periph = data->peripheral;
+	struct wii_btn_data frame;
+	for (int i = 0; i < CONFIG_WII_COMBINED_FETCH_PROBES; i++){
+		if (wii_read_data_combined(&cfg->i2c, 0x00, frame.raw, sizeof(frame.raw)) != 0 ||
+			!wii_frame_valid(&frame)){
+			return false;
+		}
+		if (periph->pending != NULL && periph->pending(&frame)){
+			data->probed[data->probed_count++] = frame;
+		}
+	}
+	return true;
 }
 
 /**
@@ -157,9 +453,9 @@ static int handle_device_setup(const struct device *dev){
 	}
 	k_usleep(CONFIG_WII_WRITE_READ_DELAY_US);
 
-	/* Bit twiddling to have the ids match with simple comparison */
-	uint64_t id = (*(uint64_t *)buf);
-	
+	/* The 6 id bytes, first byte most significant, as in the table */
+	uint64_t id = sys_get_be48(buf);
+
 	for (int i = 0; i < ARRAY_SIZE(wii_peripheral_table); i++){
 		const struct wii_peripheral * pitem = &wii_peripheral_table[i];
 		if (id == pitem->id){
@@ -190,15 +486,49 @@ static int wii_periph_poll_data(const struct device * dev, struct wii_btn_data *
 	struct wii_periph_data *data = dev->data;
 	const struct wii_periph_config *cfg = dev->config;
 	if(!data->peripheral){
-		/* There is no supported peripheral attached */
+		/* There is no supported peripheral attached. Discovery takes several
+		transfers and delays, so it is only attempted every so often. */
+		if (k_uptime_get() < data->next_discovery){
+			return -ENOENT;
+		}
 		handle_device_setup(dev);
 		if (!data->peripheral){
 			/* Still no device -- don't fetch */
+			data->next_discovery = k_uptime_get() + CONFIG_WII_DISCOVERY_INTERVAL_MS;
 			return -ENOENT;
 		}
+		data->probed_count = 0;
+		data->probed_next = 0;
+		data->deferred_valid = false;
+		data->combined = IS_ENABLED(CONFIG_WII_COMBINED_FETCH) && wii_probe_combined(dev);
+		LOG_INF("%s: %s attached, %s fetch", dev->name, data->peripheral->label,
+			data->combined ? "single transaction" : "delayed");
+	}
+	if (data->deferred_valid){
+		/* Older than any event left from the probe */
+		*wii = data->deferred;
+		data->deferred_valid = false;
+		return 0;
+	}
+	if (data->probed_next < data->probed_count){
+		/* Events dequeued by the probe come first, in order */
+		*wii = data->probed[data->probed_next++];
+		return 0;
 	}
 
-	int rc = wii_read_data_slow(&cfg->i2c, 0x00, wii->raw, 6);
+	int rc;
+	if (data->combined){
+		rc = wii_read_data_combined(&cfg->i2c, 0x00, wii->raw, 6);
+		if (rc == 0 && !wii_frame_valid(wii)){
+			/* The peripheral can not keep up after all, for good */
+			LOG_WRN("%s: invalid frame, falling back to delayed fetch", dev->name);
+			data->combined = false;
+			rc = wii_read_data_slow(&cfg->i2c, 0x00, wii->raw, 6);
+		}
+	}
+	else {
+		rc = wii_read_data_slow(&cfg->i2c, 0x00, wii->raw, 6);
+	}
 	if (rc != 0){
 		/* error reading device, assume a disconnect */
 		data->peripheral = NULL;
@@ -207,8 +537,160 @@ static int wii_periph_poll_data(const struct device * dev, struct wii_btn_data *
 }
 
 /**
- * @brief Initialize the driver. Will attempt to find an
- * attached controller right away.
+ * @brief Build the GAMEPAD_CHANGED_* mask between two decoded states
+ * 
+ */
+static uint32_t wii_state_changes(const struct wii_gamepad_state * prev,
+	const struct wii_gamepad_state * next, uint8_t axes){
+	uint32_t changed = 0;
+	if (prev->buttons != next->buttons){
+		changed |= GAMEPAD_CHANGED_BUTTONS;
+	}
+	for (int i = 0; i < axes; i++){
+		if (prev->axes[i] != next->axes[i]){
+			changed |= GAMEPAD_CHANGED_AXIS(i);
+		}
+	}
+	return changed;
+}
+
+/**
+ * @brief Hold latched buttons for at least CONFIG_WII_HIT_HOLD_US after
+ * they were last seen, so that hits shorter than a USB frame still reach
+ * the host, and merge the held ones into `state`.
+ * 
+ * @param data : device driver data
+ * @param latched : momentary buttons of the peripheral
+ * @param release : held buttons to release now, however long they were held
+ * @param state : decoded controls
+ */
+static void wii_latch_hits(struct wii_periph_data * data, uint32_t latched,
+	uint32_t release, struct wii_gamepad_state * state){
+	const uint32_t hold = k_us_to_cyc_ceil32(CONFIG_WII_HIT_HOLD_US);
+	uint32_t now = k_cycle_get_32();
+	uint32_t hits = state->buttons & latched;
+	uint32_t held = data->held & ~hits & ~release;
+	while (hits){
+		int i = find_lsb_set(hits) - 1;
+		data->hit_time[i] = now;
+		hits &= ~BIT(i);
+	}
+	while (held){
+		int i = find_lsb_set(held) - 1;
+		if (now - data->hit_time[i] < hold){
+			state->buttons |= BIT(i);
+		}
+		held &= ~BIT(i);
+	}
+	data->held = state->buttons & latched;
+}
+
+/**
+ * @brief Poll the latest frame and decode it straight into a report.
+ * 
+ * Peripherals which queue events (drum kits) send one per frame, so
+ * frames are read back to back until the queue is drained, or up to
+ * CONFIG_WII_BURST_READS, and every event of the burst is reported.
+ * Each hit must reach the host as its own press: the burst stops at a
+ * second hit of a pad, which is kept for the next read, and a pad still
+ * pressed in the last report is released for one report first.
+ * 
+ * @param dev : pointer to device driver
+ * @param layout : layout of the report
+ * @param report : report to fill
+ * @param changed : set to the controls which changed since the previous read
+ * @retval 0 on success
+ * @retval -ENOTSUP if the attached peripheral has no gamepad decoder
+ * @retval -errno otherwise (see wii_periph_poll_data())
+ */
+static int wii_periph_read(const struct device * dev, const struct gamepad_layout * layout,
+	uint8_t * report, uint32_t * changed){
+	struct wii_periph_data *data = dev->data;
+	struct wii_btn_data frames[CONFIG_WII_BURST_READS];
+	const struct wii_peripheral * periph;
+	/* Pads hit during the burst, and pads pressed in the last report to release */
+	uint32_t hits = 0;
+	uint32_t release = 0;
+	int count = 0;
+	do {
+		int rc = wii_periph_poll_data(dev, &frames[count]);
+		if (rc != 0){
+			/* Whatever is attached next starts from a clean slate */
+			data->state_valid = false;
+			data->held = 0;
+			return rc;
+		}
+		periph = data->peripheral;
+		uint32_t hit = (periph->hit != NULL) ? periph->hit(&frames[count]) : 0;
+		if (hit & (hits | data->held)){
+			data->deferred = frames[count];
+			data->deferred_valid = true;
+			release = hit & data->held & ~hits;
+			break;
+		}
+		hits |= hit;
+		count++;
+	} while (periph->pending != NULL && periph->pending(&frames[count - 1]) &&
+		count < CONFIG_WII_BURST_READS);
+	if (periph->decode == NULL){
+		return -ENOTSUP;
+	}
+	SHREDLINK_TRACEPOINT_ENTER(DECODE, periph->peripheral);
+	/* Axes which are not in every frame (velocities) keep their last value */
+	struct wii_gamepad_state state = data->state_valid ? data->state :
+		(struct wii_gamepad_state){0};
+	/* Without any frame (a hit held back from the start), the other buttons stay */
+	state.buttons = (count == 0) ? (state.buttons & ~periph->latched) : 0;
+	for (int i = 0; i < count; i++){
+		periph->decode(&frames[i], &state);
+	}
+	if (periph->latched){
+		wii_latch_hits(data, periph->latched, release, &state);
+	}
+	*changed = data->state_valid ?
+		wii_state_changes(&data->state, &state, periph->axes) : GAMEPAD_CHANGED_ALL;
+	data->state = state;
+	data->state_valid = true;
+
+	gamepad_report_clear(layout, report);
+	gamepad_report_set_buttons(layout, report, state.buttons);
+	for (int i = 0; i < periph->axes; i++){
+		gamepad_report_set_axis(layout, report, i, state.axes[i], periph->axis_bits[i]);
+	}
+	SHREDLINK_TRACEPOINT_EXIT(DECODE, *changed);
+	return 0;
+}
+
+#ifdef CONFIG_PM_DEVICE
+/**
+ * @brief Take or release a reference on the i2c bus, so that its runtime
+ * power management only powers it down once none of its users needs it.
+ * Buses without runtime power management are left to their owner.
+ * 
+ * @param dev : pointer to device driver
+ * @param claim : true to take a reference, false to release it
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+static int wii_bus_claim(const struct device *dev, bool claim)
+{
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+	const struct wii_periph_config *cfg = dev->config;
+	const struct device *bus = cfg->i2c.bus;
+	if (bus->pm == NULL || !pm_device_runtime_is_enabled(bus)){
+		return 0;
+	}
+	return claim ? pm_device_runtime_get(bus) : pm_device_runtime_put(bus);
+#else
+	return 0;
+#endif
+}
+#endif /* CONFIG_PM_DEVICE */
+
+/**
+ * @brief Initialize the driver. Only the bus is configured: the attached
+ * controller is discovered on the first fetch, so that boot (and USB
+ * enumeration) never waits for it.
  * 
  * @param dev : pointer to device driver
  * @retval 0 on success
@@ -217,32 +699,76 @@ static int wii_periph_poll_data(const struct device * dev, struct wii_btn_data *
 static int wii_periph_init(const struct device *dev)
 {
     struct wii_periph_data *data = dev->data;
-	int rc = wii_bus_config(dev);
-	if (rc == 0){
-		handle_device_setup(dev);
-		if (!data->peripheral){
-			LOG_WRN("No supported device attached");
-		}
+	data->peripheral = NULL;
+	data->held = 0;
+	data->next_discovery = 0;
+#ifdef CONFIG_PM_DEVICE
+	int rc = wii_bus_claim(dev, true);
+	if (rc != 0){
+		return rc;
 	}
-	return rc;
+#endif
+	return wii_bus_config(dev);
 }
 
-static struct wii_periph_data wii_periph_data = {
-	.wii = {
-		.raw = {0}
-	},
-	.peripheral = NULL
-};
-
-static const struct wii_periph_config wii_periph_cfg = {
-	.i2c = I2C_DT_SPEC_INST_GET(0),
-	.speed = I2C_SPEED_FAST
-};
+#ifdef CONFIG_PM_DEVICE
+/**
+ * @brief Release the i2c bus along with the peripheral, and take it back
+ * on resume. The bus may have other users, so it is only powered down
+ * by its runtime power management once none of them needs it. The
+ * controller may have been swapped in between, so the next read reports
+ * its full state again.
+ * 
+ * @param dev : pointer to device driver
+ * @param action : power management action
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+static int wii_periph_pm_action(const struct device *dev, enum pm_device_action action)
+{
+	struct wii_periph_data *data = dev->data;
+	int rc;
+	switch (action){
+	case PM_DEVICE_ACTION_SUSPEND:
+		return wii_bus_claim(dev, false);
+	case PM_DEVICE_ACTION_RESUME:
+		rc = wii_bus_claim(dev, true);
+		if (rc == 0){
+			data->state_valid = false;
+			rc = wii_bus_config(dev);
+		}
+		return rc;
+	default:
+		return -ENOTSUP;
+	}
+}
+#endif /* CONFIG_PM_DEVICE */
 
 static const struct wii_periph_driver_api wii_api_funcs = {
+	.gamepad = {
+		.read = wii_periph_read,
+	},
 	.fetch = wii_periph_poll_data,
 };
 
-DEVICE_DT_INST_DEFINE(0, wii_periph_init, NULL,
-		    &wii_periph_data, &wii_periph_cfg, POST_KERNEL,
-		    CONFIG_APPLICATION_INIT_PRIORITY, &wii_api_funcs);
+#define WII_PERIPH_DEFINE(inst) \
+	static struct wii_periph_data wii_periph_data_##inst = { \
+		.wii = { \
+			.raw = {0} \
+		}, \
+		.peripheral = NULL, \
+		.state_valid = false \
+	}; \
+	\
+	static const struct wii_periph_config wii_periph_cfg_##inst = { \
+		.i2c = I2C_DT_SPEC_INST_GET(inst), \
+		.speed = I2C_SPEED_FAST \
+	}; \
+	\
+	PM_DEVICE_DT_INST_DEFINE(inst, wii_periph_pm_action); \
+	\
+	DEVICE_DT_INST_DEFINE(inst, wii_periph_init, PM_DEVICE_DT_INST_GET(inst), \
+			&wii_periph_data_##inst, &wii_periph_cfg_##inst, POST_KERNEL, \
+			CONFIG_APPLICATION_INIT_PRIORITY, &wii_api_funcs);
+
+DT_INST_FOREACH_STATUS_OKAY(WII_PERIPH_DEFINE)
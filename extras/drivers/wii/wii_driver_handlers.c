@@ -17,6 +17,26 @@
 static inline int z_vrfy_wii_peripheral_fetch(const struct device *dev, struct wii_btn_data * data)
 { 
     Z_OOPS(Z_SYSCALL_DRIVER_WII_PERIPHERAL_DRIVER(dev, fetch)); 
+    Z_OOPS(Z_SYSCALL_MEMORY_WRITE(data, sizeof(*data)));
     return z_impl_wii_peripheral_fetch((const struct device *)dev, data); 
 }
 #include <syscalls/wii_peripheral_fetch_mrsh.c>
+
+static inline int z_vrfy_wii_peripheral_fetch_batch(const struct device * const * devs,
+                                                    struct wii_frame * frames, size_t count)
+{
+    const struct device * kdevs[CONFIG_WII_FETCH_BATCH_MAX];
+    Z_OOPS(Z_SYSCALL_VERIFY_MSG(count <= ARRAY_SIZE(kdevs),
+        "batch of %zu frames is larger than CONFIG_WII_FETCH_BATCH_MAX", count));
+    Z_OOPS(z_user_from_copy(kdevs, devs, count * sizeof(kdevs[0])));
+    for (size_t i = 0; i < count; i++){
+        /* Devices listed back to back are only checked once */
+        if (i == 0 || kdevs[i] != kdevs[i - 1]){
+            Z_OOPS(Z_SYSCALL_DRIVER_WII_PERIPHERAL_DRIVER(kdevs[i], fetch));
+        }
+    }
+    /* The whole buffer is checked once, frames are then written in place */
+    Z_OOPS(Z_SYSCALL_MEMORY_ARRAY_WRITE(frames, count, sizeof(*frames)));
+    return z_impl_wii_peripheral_fetch_batch(kdevs, frames, count);
+}
+#include <syscalls/wii_peripheral_fetch_batch_mrsh.c>
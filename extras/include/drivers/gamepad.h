@@ -0,0 +1,210 @@
+/**
+ * @file gamepad.h
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Generic API for gamepad backends
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * A gamepad backend decodes the state of its controller directly into a
+ * report buffer provided by the caller, following a `struct gamepad_layout`
+ * which describes where each button and axis lives in that buffer. The
+ * buffer is then ready to be sent as is, and the returned change mask tells
+ * the caller whether there is anything worth sending at all.
+ *
+ * Buttons are numbered in the order defined by each backend, and occupy
+ * bits [0, layout->buttons) of the report. Buttons the layout has no room
+ * for are dropped. Axes are scaled from the resolution of the controller to
+ * the resolution declared by the layout.
+ */
+
+#ifndef SHREDLINK_INCLUDE_DRIVERS_GAMEPAD_H_
+#define SHREDLINK_INCLUDE_DRIVERS_GAMEPAD_H_
+
+#include <errno.h>
+#include <zephyr/types.h>
+#include <device.h>
+#include <string.h>
+#include <sys/util.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GAMEPAD_MAX_AXES		8
+
+/* Bits of the change mask returned by gamepad_read() */
+#define GAMEPAD_CHANGED_BUTTONS	BIT(0)
+#define GAMEPAD_CHANGED_AXIS(n)	BIT((n) + 1)
+#define GAMEPAD_CHANGED_ALL		BIT_MASK(GAMEPAD_MAX_AXES + 1)
+
+/**
+ * @brief Position of a single axis in the report
+ *
+ */
+struct gamepad_axis_layout {
+	/* Bit offset of the field in the report */
+	uint16_t offset;
+	/* Number of bits the field occupies */
+	uint8_t width;
+	/* Resolution of the value held in the field */
+	uint8_t bits;
+};
+
+/**
+ * @brief Layout of the report a backend decodes into
+ *
+ */
+struct gamepad_layout {
+	/* Size of the report in bytes */
+	uint8_t size;
+	uint8_t buttons;
+	uint8_t axes;
+	struct gamepad_axis_layout axis[GAMEPAD_MAX_AXES];
+};
+
+/**
+ * @brief Write the lowest `width` bits of `value` into `report` at bit `offset`.
+ * The bits must be clear beforehand.
+ *
+ */
+static inline void gamepad_report_put(uint8_t * report, size_t offset, size_t width, uint32_t value){
+	size_t end = offset + width;
+	while (offset < end){
+		size_t shift = offset % 8;
+		size_t n = MIN(8 - shift, end - offset);
+		report[offset / 8] |= (uint8_t)((value & BIT_MASK(n)) << shift);
+		value >>= n;
+		offset += n;
+	}
+}
+
+static inline void gamepad_report_clear(const struct gamepad_layout * layout, uint8_t * report){
+	memset(report, 0, layout->size);
+}
+
+/**
+ * @brief Set the state of every button at once, button 0 being bit 0 of `buttons`
+ *
+ */
+static inline void gamepad_report_set_buttons(const struct gamepad_layout * layout,
+	uint8_t * report, uint32_t buttons){
+	gamepad_report_put(report, 0, layout->buttons, buttons);
+}
+
+/**
+ * @brief Set or clear a single button, regardless of its previous state
+ *
+ */
+static inline void gamepad_report_set_button(const struct gamepad_layout * layout,
+	uint8_t * report, uint8_t button, bool pressed){
+	if (button < layout->buttons){
+		WRITE_BIT(report[button / 8], button % 8, pressed);
+	}
+}
+
+/**
+ * @brief Set an axis from a value with a resolution of `native_bits`.
+ * Values are scaled up by repeating their bits below themselves, so that
+ * the full scale of the control is the logical maximum of the axis.
+ *
+ */
+static inline void gamepad_report_set_axis(const struct gamepad_layout * layout,
+	uint8_t * report, uint8_t axis, uint32_t value, uint8_t native_bits){
+	if (axis >= layout->axes){
+		return;
+	}
+	const struct gamepad_axis_layout * field = &layout->axis[axis];
+	value &= BIT_MASK(native_bits);
+	if (field->bits > native_bits && native_bits > 0){
+		uint32_t scaled = 0;
+		for (int shift = field->bits - native_bits; shift > -native_bits; shift -= native_bits){
+			scaled |= (shift >= 0) ? (value << shift) : (value >> -shift);
+		}
+		value = scaled;
+	}
+	else if (field->bits < native_bits){
+		value >>= native_bits - field->bits;
+	}
+	gamepad_report_put(report, field->offset, field->width, value);
+}
+
+/**
+ * @brief Decode the latest state of the controller into `report`.
+ *
+ * @param dev : gamepad backend
+ * @param layout : layout of `report`
+ * @param report : buffer of `layout->size` bytes. It is always fully written on success.
+ * @param changed : GAMEPAD_CHANGED_* mask of what changed since the previous read
+ * @retval 0 on success
+ * @retval -errno otherwise
+ */
+typedef int (*gamepad_api_read)(const struct device *dev, const struct gamepad_layout * layout,
+	uint8_t * report, uint32_t * changed);
+
+/**
+ * @brief Called when the state of the controller may have changed.
+ * Can be called from an interrupt.
+ *
+ * @param dev : gamepad backend
+ */
+typedef void (*gamepad_trigger_handler_t)(const struct device *dev);
+
+/**
+ * @brief Install (or remove, with a NULL `handler`) the change handler.
+ * Optional: backends which can only be polled leave it NULL.
+ *
+ */
+typedef int (*gamepad_api_trigger_set)(const struct device *dev,
+	gamepad_trigger_handler_t handler);
+
+/**
+ * @brief Gamepad backend API.
+ *
+ * Backends which also provide a device specific API place this
+ * structure first in it, so that gamepad_read() works for them too.
+ *
+ */
+struct gamepad_driver_api {
+	gamepad_api_read read;
+	gamepad_api_trigger_set trigger_set;
+};
+
+static inline int gamepad_read(const struct device *dev, const struct gamepad_layout * layout,
+	uint8_t * report, uint32_t * changed)
+{
+	const struct gamepad_driver_api *api =
+				(const struct gamepad_driver_api *)dev->api;
+
+	return api->read(dev, layout, report, changed);
+}
+
+/**
+ * @brief Ask the backend to call `handler` whenever its controller changes,
+ * so that it only needs to be read after a call.
+ *
+ * @param dev : gamepad backend
+ * @param handler : handler to install, NULL to stop calling it
+ * @retval 0 on success
+ * @retval -ENOTSUP if the backend can only be polled
+ * @retval -errno otherwise
+ */
+static inline int gamepad_trigger_set(const struct device *dev,
+	gamepad_trigger_handler_t handler)
+{
+	const struct gamepad_driver_api *api =
+				(const struct gamepad_driver_api *)dev->api;
+
+	if (api->trigger_set == NULL){
+		return -ENOTSUP;
+	}
+	return api->trigger_set(dev, handler);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHREDLINK_INCLUDE_DRIVERS_GAMEPAD_H_ */
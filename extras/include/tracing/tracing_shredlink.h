@@ -0,0 +1,75 @@
+/**
+ * @file tracing_shredlink.h
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Trace points of the acquisition and reporting pipeline
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Each stage of the pipeline is bracketed by an enter and an exit event,
+ * emitted in CTF alongside the kernel events when CONFIG_SHREDLINK_TRACEPOINTS
+ * is enabled (see extras/subsys/tracing/shredlink.tsdl for the metadata).
+ * Otherwise the trace points compile to nothing, arguments included.
+ * These time the stages; the input traces of CONFIG_SHREDLINK_TRACE
+ * (shredlink/trace.h) record the reports themselves.
+ */
+
+#ifndef SHREDLINK_INCLUDE_TRACING_TRACING_SHREDLINK_H_
+#define SHREDLINK_INCLUDE_TRACING_TRACING_SHREDLINK_H_
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Pipeline stages, in the order a frame goes through them.
+ * The values are part of the CTF metadata, only append to this list.
+ */
+enum shredlink_tracepoint_stage {
+	SHREDLINK_TRACEPOINT_POLL_TICK,
+	SHREDLINK_TRACEPOINT_I2C_WRITE,
+	SHREDLINK_TRACEPOINT_DATA_READY_WAIT,
+	SHREDLINK_TRACEPOINT_I2C_READ,
+	SHREDLINK_TRACEPOINT_DECODE,
+	SHREDLINK_TRACEPOINT_QUEUE,
+	SHREDLINK_TRACEPOINT_HID_DEQUEUE,
+	SHREDLINK_TRACEPOINT_EP_WRITE,
+	SHREDLINK_TRACEPOINT_TILT_ISR,
+	SHREDLINK_TRACEPOINT_TILT_HANDLER,
+};
+
+#ifdef CONFIG_SHREDLINK_TRACEPOINTS
+void sys_trace_shredlink_enter(enum shredlink_tracepoint_stage stage, uint32_t arg);
+void sys_trace_shredlink_exit(enum shredlink_tracepoint_stage stage, int32_t result);
+
+/**
+ * @brief Mark the start of `stage`
+ *
+ * @param stage : stage name, without the SHREDLINK_TRACEPOINT_ prefix
+ * @param arg : stage specific argument (gamepad index, slot, ...)
+ */
+#define SHREDLINK_TRACEPOINT_ENTER(stage, arg) \
+	sys_trace_shredlink_enter(SHREDLINK_TRACEPOINT_##stage, (uint32_t)(arg))
+
+/**
+ * @brief Mark the end of `stage`
+ *
+ * @param stage : stage name, without the SHREDLINK_TRACEPOINT_ prefix
+ * @param result : outcome of the stage, 0 or -errno in general
+ */
+#define SHREDLINK_TRACEPOINT_EXIT(stage, result) \
+	sys_trace_shredlink_exit(SHREDLINK_TRACEPOINT_##stage, (int32_t)(result))
+#else
+#define SHREDLINK_TRACEPOINT_ENTER(stage, arg) do { } while (false)
+#define SHREDLINK_TRACEPOINT_EXIT(stage, result) do { } while (false)
+#endif /* CONFIG_SHREDLINK_TRACEPOINTS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHREDLINK_INCLUDE_TRACING_TRACING_SHREDLINK_H_ */
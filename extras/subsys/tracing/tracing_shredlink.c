@@ -0,0 +1,37 @@
+/**
+ * @file tracing_shredlink.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief CTF events of the pipeline trace points
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Events are written through the CTF backend selected for the kernel
+ * events, with ids above the range Zephyr uses. They must match the
+ * declarations of shredlink.tsdl.
+ */
+
+#include <zephyr.h>
+#include <ctf_top.h>
+#include <tracing/tracing_shredlink.h>
+
+#define CTF_EVENT_SHREDLINK_ENTER	0xe0
+#define CTF_EVENT_SHREDLINK_EXIT	0xe1
+
+void sys_trace_shredlink_enter(enum shredlink_tracepoint_stage stage, uint32_t arg){
+	CTF_EVENT(
+		CTF_LITERAL(uint8_t, CTF_EVENT_SHREDLINK_ENTER),
+		(uint8_t)stage,
+		arg
+		);
+}
+
+void sys_trace_shredlink_exit(enum shredlink_tracepoint_stage stage, int32_t result){
+	CTF_EVENT(
+		CTF_LITERAL(uint8_t, CTF_EVENT_SHREDLINK_EXIT),
+		(uint8_t)stage,
+		result
+		);
+}
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+# Copyright (c) 2026 Brian Bradley
+# SPDX-License-Identifier: Apache-2.0
+"""
+Sample-to-arrival latency of the reports of a gamepad, read through hidraw.
+
+Requires an adapter built with CONFIG_SHREDLINK_REPORT_TIMESTAMP, which ends
+every report with the time at which the input was sampled (wrapping
+microseconds, little endian) and a sequence number (16 bits, little endian).
+Each report is timestamped as it is read, and the difference with its sample
+time gives its latency, up to the offset between both clocks.
+
+The offset is not known, so latencies are given relative to the fastest
+reports: the lowest differences seen over each window are fitted with a line,
+which also absorbs the drift between both clocks. Whatever the fastest report
+took (at least a bus frame) is therefore not included. Gaps in the sequence
+numbers are reports which were dropped or replaced before reaching the host.
+
+Inputs must keep changing while measuring, since only changes are reported:
+
+    sudo scripts/hidraw_latency.py /dev/hidraw3 --seconds 30
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import time
+
+STAMP = struct.Struct("<IH")
+SAMPLE_WRAP = 1 << 32
+SEQUENCE_WRAP = 1 << 16
+
+
+def percentile(values, pct):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(round(pct / 100 * (len(ordered) - 1))))]
+
+
+def capture(path, seconds):
+    """Read reports for `seconds`, returns (arrival_us, sample_us, sequence) tuples"""
+    fd = os.open(path, os.O_RDONLY | os.O_NONBLOCK)
+    samples = []
+    try:
+        end = time.monotonic() + seconds
+        while True:
+            left = end - time.monotonic()
+            if left <= 0:
+                break
+            ready, _, _ = select.select([fd], [], [], left)
+            if not ready:
+                continue
+            arrival = time.monotonic_ns() // 1000
+            report = os.read(fd, 64)
+            if len(report) < STAMP.size:
+                continue
+            sample, sequence = STAMP.unpack_from(report, len(report) - STAMP.size)
+            samples.append((arrival, sample, sequence))
+    finally:
+        os.close(fd)
+    return samples
+
+
+def unwrap(samples):
+    """Extend the wrapping sample times of the device to 64 bits"""
+    unwrapped = []
+    base = 0
+    last = None
+    for arrival, sample, sequence in samples:
+        if last is not None and sample < last and last - sample > SAMPLE_WRAP // 2:
+            base += SAMPLE_WRAP
+        last = sample
+        unwrapped.append((arrival, base + sample, sequence))
+    return unwrapped
+
+
+def skipped(samples):
+    """Sequence numbers missing between consecutive reports"""
+    count = 0
+    for (_, _, prev), (_, _, seq) in zip(samples, samples[1:]):
+        count += (seq - prev - 1) % SEQUENCE_WRAP
+    return count
+
+
+def floor_line(samples, window_us):
+    """
+    Fit `arrival - sample` of the fastest report of each window against the
+    sample time, returns (slope, intercept).
+    """
+    floors = {}
+    for arrival, sample, _ in samples:
+        key = sample // window_us
+        delta = arrival - sample
+        if key not in floors or delta < floors[key][1]:
+            floors[key] = (sample, delta)
+    points = list(floors.values())
+    if len(points) < 2:
+        return 0.0, float(min(d for _, d in points))
+    n = len(points)
+    mean_x = sum(x for x, _ in points) / n
+    mean_y = sum(y for _, y in points) / n
+    var = sum((x - mean_x) ** 2 for x, _ in points)
+    slope = sum((x - mean_x) * (y - mean_y) for x, y in points) / var if var else 0.0
+    intercept = mean_y - slope * mean_x
+    # Move the line under the fastest report of every window
+    intercept += min(y - (slope * x + intercept) for x, y in points)
+    return slope, intercept
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("hidraw", help="hidraw node of the gamepad, e.g. /dev/hidraw3")
+    parser.add_argument("--seconds", type=float, default=10.0)
+    parser.add_argument("--window", type=float, default=1.0,
+                        help="seconds per window when estimating the clock offset and drift")
+    args = parser.parse_args()
+
+    samples = unwrap(capture(args.hidraw, args.seconds))
+    if len(samples) < 2:
+        print("reports n={}: keep the inputs changing while measuring".format(len(samples)))
+        return 1
+
+    slope, intercept = floor_line(samples, int(args.window * 1e6))
+    latencies = [arrival - sample - (slope * sample + intercept)
+                 for arrival, sample, _ in samples]
+    print("latency_us n={} p50={:.0f} p90={:.0f} p99={:.0f} max={:.0f}".format(
+        len(latencies), percentile(latencies, 50), percentile(latencies, 90),
+        percentile(latencies, 99), max(latencies)))
+    print("clock drift_ppm={:.1f}".format(slope * 1e6))
+    print("sequence reports={} skipped={}".format(len(samples), skipped(samples)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,357 @@
+#!/usr/bin/env python3
+# Copyright (c) 2026 Brian Bradley
+# SPDX-License-Identifier: Apache-2.0
+"""
+End to end benchmark of the adapter running on native_posix.
+
+The application is built for native_posix (see app/boards/native_posix.*),
+which exports its USB device over USB/IP and emulates a wii guitar. This
+script starts it, attaches it to the host with `usbip`, then drives the
+emulated guitar from the shell on the UART pseudotty while reading the
+gamepad back through hidraw. It reports:
+
+  - input-to-host latency percentiles (frame injected -> report read)
+  - reports per second and report interval jitter under constant change
+  - press edges dropped when pressing faster than a human can
+
+With --players, the adapter is built with one emulated guitar per player
+(see overlays/players_native_posix.overlay). Every guitar moves its whammy
+bar on each read, and the reports per second of each hidraw node are given,
+to check that each player keeps its rate as players are added:
+
+    west build -b native_posix -s app -- \
+        -DDTC_OVERLAY_FILE="boards/native_posix.overlay;overlays/players_native_posix.overlay" \
+        -DOVERLAY_CONFIG="configs/players.conf"
+    sudo scripts/usbip_bench.py build/zephyr/zephyr.exe --players 4
+
+Attaching requires the vhci-hcd module and root privileges:
+
+    west build -b native_posix -s app
+    sudo modprobe vhci-hcd
+    sudo scripts/usbip_bench.py build/zephyr/zephyr.exe
+
+With --trace, a trace dumped from a device (`trace dump` on its shell) is
+loaded into the adapter and replayed instead, and the reports and button
+edges which reach the host are compared to the ones in the trace.
+"""
+
+import argparse
+import glob
+import os
+import random
+import re
+import select
+import statistics
+import subprocess
+import sys
+import threading
+import time
+import tty
+
+# Raw guitar frame at rest (see wii_emul.c). Buttons are active low.
+IDLE_FRAME = [0x20, 0x20, 0x00, 0x10, 0xff, 0xff]
+# Strum down: byte 4, bit 6 of the raw frame; button 9 (bit 8) of the report
+STRUM_FRAME_BYTE, STRUM_FRAME_BIT = 4, 6
+STRUM_REPORT_BIT = 8
+WHAMMY_FRAME_BYTE = 3
+# One line of `trace dump`: ns since the first report, gamepad, report in hex
+TRACE_LINE = re.compile(r"^\s*(\d+) (\d+) ([0-9a-fA-F]+)\s*$")
+
+
+def percentile(values, pct):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(round(pct / 100 * (len(ordered) - 1))))]
+
+
+def report_button(report, bit):
+    return (report[bit // 8] >> (bit % 8)) & 1
+
+
+class Adapter:
+    """The native_posix executable, its shell pseudotty and its hidraw nodes"""
+
+    def __init__(self, exe, label, busid, players=1):
+        self.label = label
+        self.busid = busid
+        self.proc = subprocess.Popen([exe], stdout=subprocess.PIPE,
+                                     stderr=subprocess.STDOUT, text=True)
+        self.pty = self._wait_for_pty()
+        threading.Thread(target=self._drain_stdout, daemon=True).start()
+        tty.setraw(self.pty)
+        threading.Thread(target=self._drain_pty, daemon=True).start()
+        self._attach()
+        self.nodes = self._wait_for_hidraw(players)
+        self.hidraws = [os.open(node, os.O_RDONLY | os.O_NONBLOCK) for node in self.nodes]
+        self.hidraw = self.hidraws[0]
+        self.frame = list(IDLE_FRAME)
+
+    def _wait_for_pty(self):
+        for line in self.proc.stdout:
+            match = re.search(r"pseudotty: (/dev/pts/\d+)", line)
+            if match:
+                return os.open(match.group(1), os.O_RDWR | os.O_NOCTTY)
+        raise RuntimeError("adapter exited before opening its pseudotty")
+
+    def _drain_stdout(self):
+        for _ in self.proc.stdout:
+            pass
+
+    def _drain_pty(self):
+        while True:
+            try:
+                os.read(self.pty, 4096)
+            except OSError:
+                return
+
+    def _attach(self):
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            if subprocess.run(["usbip", "attach", "-r", "127.0.0.1", "-b", self.busid],
+                              capture_output=True).returncode == 0:
+                return
+            time.sleep(0.2)
+        raise RuntimeError("could not attach the adapter over USB/IP")
+
+    @staticmethod
+    def _wait_for_hidraw(count):
+        """hidraw nodes of the first `count` gamepads, in interface order"""
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            found = []
+            for uevent in glob.glob("/sys/class/hidraw/hidraw*/device/uevent"):
+                with open(uevent) as f:
+                    if "shredlink" in f.read():
+                        # device is <bus>:<vid>:<pid>.<instance>, one instance per interface
+                        device = os.path.realpath(os.path.dirname(uevent))
+                        found.append((device, "/dev/" + uevent.split("/")[4]))
+            if len(found) >= count:
+                return [node for _, node in sorted(found)[:count]]
+            time.sleep(0.2)
+        raise RuntimeError("fewer than {} shredlink hidraw devices appeared".format(count))
+
+    def send(self, frame):
+        self.frame = list(frame)
+        self.shell("wii_emul frame {} {}".format(self.label, " ".join("%02x" % b for b in frame)))
+
+    def shell(self, cmd):
+        os.write(self.pty, (cmd + "\n").encode())
+
+    def read(self, timeout):
+        ready, _, _ = select.select([self.hidraw], [], [], timeout)
+        if not ready:
+            return None
+        return os.read(self.hidraw, 64)
+
+    def flush(self):
+        while self.read(0.05) is not None:
+            pass
+
+    def close(self):
+        for fd in self.hidraws:
+            os.close(fd)
+        subprocess.run(["usbip", "detach", "-p", "0"], capture_output=True)
+        self.proc.terminate()
+        self.proc.wait()
+
+
+def strum(frame, pressed):
+    frame = list(frame)
+    if pressed:
+        frame[STRUM_FRAME_BYTE] &= ~(1 << STRUM_FRAME_BIT)
+    else:
+        frame[STRUM_FRAME_BYTE] |= 1 << STRUM_FRAME_BIT
+    return frame
+
+
+def measure_latency(adapter, iterations):
+    latencies = []
+    pressed = False
+    adapter.flush()
+    for _ in range(iterations):
+        pressed = not pressed
+        adapter.send(strum(adapter.frame, pressed))
+        start = time.monotonic_ns()
+        while True:
+            report = adapter.read(0.5)
+            if report is None:
+                break
+            if report_button(report, STRUM_REPORT_BIT) == pressed:
+                latencies.append((time.monotonic_ns() - start) / 1000)
+                break
+        time.sleep(random.uniform(0.005, 0.015))
+    return latencies
+
+
+def measure_rate(adapter, seconds):
+    arrivals = []
+    adapter.flush()
+    frame = list(adapter.frame)
+    end = time.monotonic() + seconds
+    whammy = 0
+    while time.monotonic() < end:
+        whammy = (whammy + 1) % 32
+        frame[WHAMMY_FRAME_BYTE] = whammy
+        adapter.send(frame)
+        while adapter.read(0) is not None:
+            arrivals.append(time.monotonic_ns())
+    intervals = [(b - a) / 1000 for a, b in zip(arrivals, arrivals[1:])]
+    return len(arrivals) / seconds, intervals
+
+
+def measure_players(adapter, players, seconds):
+    """Reports per second and intervals of each hidraw node, every guitar changing on each read"""
+    labels = [adapter.label] + ["{}_{}".format(adapter.label, i) for i in range(1, players)]
+    for fd in adapter.hidraws:
+        while select.select([fd], [], [], 0.05)[0]:
+            os.read(fd, 64)
+    for label in labels:
+        adapter.shell("wii_emul sweep {} 1".format(label))
+    # Leave the shell time to start every guitar before counting
+    time.sleep(0.2)
+    arrivals = {fd: [] for fd in adapter.hidraws}
+    end = time.monotonic() + seconds
+    while True:
+        left = end - time.monotonic()
+        if left <= 0:
+            break
+        ready, _, _ = select.select(adapter.hidraws, [], [], left)
+        now = time.monotonic_ns()
+        for fd in ready:
+            os.read(fd, 64)
+            arrivals[fd].append(now)
+    for label in labels:
+        adapter.shell("wii_emul sweep {} 0".format(label))
+    results = []
+    for node, fd in zip(adapter.nodes, adapter.hidraws):
+        times = arrivals[fd]
+        intervals = [(b - a) / 1000 for a, b in zip(times, times[1:])]
+        results.append((node, len(times) / seconds, intervals))
+    return results
+
+
+def measure_edges(adapter, presses, hold):
+    adapter.flush()
+    seen = 0
+    last = 0
+    for _ in range(presses):
+        adapter.send(strum(adapter.frame, True))
+        time.sleep(hold)
+        adapter.send(strum(adapter.frame, False))
+        time.sleep(hold)
+        while True:
+            report = adapter.read(0)
+            if report is None:
+                break
+            state = report_button(report, STRUM_REPORT_BIT)
+            seen += state and not last
+            last = state
+    return seen
+
+
+def count_edges(reports, bits):
+    edges = 0
+    last = reports[0] if reports else b""
+    for report in reports[1:]:
+        edges += sum(report_button(report, bit) and not report_button(last, bit)
+                     for bit in range(min(bits, 8 * len(report))))
+        last = report
+    return edges
+
+
+def replay_trace(adapter, path, speed, bits):
+    entries = []
+    with open(path) as f:
+        for line in f:
+            match = TRACE_LINE.match(line)
+            if match:
+                entries.append((int(match.group(1)), int(match.group(2)), match.group(3)))
+    if not entries:
+        raise RuntimeError("no trace entries in " + path)
+    adapter.shell("trace clear")
+    for ns, gamepad, report in entries:
+        adapter.shell("trace put {} {} {}".format(ns, gamepad, report))
+        # Leave the shell time to process each line
+        time.sleep(0.002)
+    adapter.flush()
+    expected = [bytes.fromhex(report) for _, gamepad, report in entries if gamepad == 0]
+    duration = (entries[-1][0] - entries[0][0]) / 1e9 / max(speed, 1)
+    adapter.shell("trace replay {}".format(speed))
+    received = []
+    end = time.monotonic() + duration + 1.0
+    while time.monotonic() < end:
+        report = adapter.read(0.05)
+        if report is not None:
+            received.append(report)
+    return len(expected), len(received), count_edges(expected, bits), count_edges(received, bits)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("exe", help="zephyr.exe built for native_posix")
+    parser.add_argument("--label", default="WII", help="label of the emulated guitar")
+    parser.add_argument("--busid", default="1-1", help="USB/IP bus id of the adapter")
+    parser.add_argument("--iterations", type=int, default=500)
+    parser.add_argument("--rate-seconds", type=float, default=5.0)
+    parser.add_argument("--presses", type=int, default=200)
+    parser.add_argument("--hold-ms", type=float, default=2.0,
+                        help="press and release duration for the dropped edge test")
+    parser.add_argument("--players", type=int, default=0,
+                        help="report rate of each of this many emulated guitars, "
+                             "instead of the single gamepad tests")
+    parser.add_argument("--trace", help="replay this trace instead of the synthetic tests")
+    parser.add_argument("--speed", type=int, default=1,
+                        help="trace replay speed, 1 for the original timing")
+    parser.add_argument("--edge-bits", type=int, default=16,
+                        help="report bits (from bit 0) counted as buttons in the trace")
+    args = parser.parse_args()
+
+    adapter = Adapter(args.exe, args.label, args.busid, max(args.players, 1))
+    if args.players:
+        try:
+            results = measure_players(adapter, args.players, args.rate_seconds)
+        finally:
+            adapter.close()
+        for node, rate, intervals in results:
+            if len(intervals) > 1:
+                print("player_rate node={} per_s={:.0f} interval_us p50={:.0f} p99={:.0f}".format(
+                    node, rate, percentile(intervals, 50), percentile(intervals, 99)))
+            else:
+                print("player_rate node={} per_s={:.0f}".format(node, rate))
+        return 0 if all(rate > 0 for _, rate, _ in results) else 1
+
+    if args.trace:
+        try:
+            sent, received, expected, seen = replay_trace(adapter, args.trace,
+                                                          args.speed, args.edge_bits)
+        finally:
+            adapter.close()
+        print("trace reports sent={} received={} edges expected={} seen={} dropped={}".format(
+            sent, received, expected, seen, expected - seen))
+        return 0 if seen == expected else 1
+
+    try:
+        latencies = measure_latency(adapter, args.iterations)
+        rate, intervals = measure_rate(adapter, args.rate_seconds)
+        seen = measure_edges(adapter, args.presses, args.hold_ms / 1000)
+    finally:
+        adapter.close()
+
+    if latencies:
+        print("latency_us n={} p50={:.0f} p90={:.0f} p99={:.0f} max={:.0f} lost={}".format(
+            len(latencies), percentile(latencies, 50), percentile(latencies, 90),
+            percentile(latencies, 99), max(latencies), args.iterations - len(latencies)))
+    else:
+        print("latency_us n=0 lost={}".format(args.iterations))
+    if len(intervals) > 1:
+        print("report_rate per_s={:.0f} interval_us p50={:.0f} p99={:.0f} stdev={:.0f}".format(
+            rate, percentile(intervals, 50), percentile(intervals, 99),
+            statistics.stdev(intervals)))
+    else:
+        print("report_rate per_s={:.0f}".format(rate))
+    print("edges sent={} seen={} dropped={}".format(args.presses, seen, args.presses - seen))
+    return 0 if latencies and seen == args.presses else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
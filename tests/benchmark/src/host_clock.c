@@ -0,0 +1,22 @@
+/**
+ * @file host_clock.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * On native_posix, simulated time stands still while code runs, so stages
+ * are timed with the clock of the host instead. Only built for native_posix,
+ * against the C library of the host.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+uint64_t bench_host_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,362 @@
+/**
+ * @file main.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Microbenchmarks of the per-frame path, from the bus to the report slot
+ * handed over to the reporting thread. Every stage runs BENCH_SAMPLES times
+ * over BENCH_BATCH inputs of a strum pattern, and one line is printed per
+ * stage:
+ *
+ *   BENCH <stage> unit=<cycles|ns> n=<samples>x<batch> min=<> median=<> max=<>
+ *
+ * with the cost of a single iteration. Lines only change when the code does,
+ * so they can be diffed between commits. On native_posix, simulated time
+ * stands still while code runs, so the host clock is used instead.
+ *
+ * The time a wii frame fetch keeps the emulated i2c bus busy is printed as
+ *
+ *   BUS <mode> transactions=<> bytes=<> ns=<> wait_ns=<> fetch_ns=<>
+ *
+ * per frame, where mode is the fetch mode the driver settled on (the
+ * delayed_fetch scenario disables single transaction fetches, and waits
+ * CONFIG_WII_WRITE_READ_DELAY_US for the data like with an official
+ * peripheral). ns is the time on the wire, wait_ns the time between
+ * selecting the data register and reading it, and fetch_ns both.
+ *
+ * Fetches are also timed from a thread of their own, one frame per call
+ * (`wii_fetch_thread`) and BENCH_FETCH_BATCH frames per call
+ * (`wii_fetch_batch_thread`), and with userspace (the userspace scenario)
+ * from a user thread as well (`wii_fetch_user`, `wii_fetch_batch_user`).
+ * The difference between a user and a supervisor line is the cost of the
+ * syscall and its verification, per frame, printed as
+ *
+ *   SYSCALL unit=<cycles|ns> single=<> batch=<>
+ *
+ * from the medians.
+ */
+
+#include <string.h>
+#include <zephyr.h>
+#include <ztest.h>
+#include <drivers/gamepad.h>
+#include <shredlink/report.h>
+#include <wii.h>
+#include <wii_emul.h>
+
+#define BENCH_SAMPLES	101
+#define BENCH_BATCH		64
+#define PATTERN_LEN		32
+#define BENCH_FETCH_BATCH	MIN(8, CONFIG_WII_FETCH_BATCH_MAX)
+
+#define ALIGNED	DT_NODELABEL(gamepad_aligned)
+#define PACKED	DT_NODELABEL(gamepad_packed)
+
+GAMEPAD_LAYOUT_CHECK(ALIGNED)
+GAMEPAD_LAYOUT_CHECK(PACKED)
+
+static const struct gamepad_layout layout_aligned = GAMEPAD_LAYOUT_INIT(ALIGNED);
+static const struct gamepad_layout layout_packed = GAMEPAD_LAYOUT_INIT(PACKED);
+
+#ifdef CONFIG_BOARD_NATIVE_POSIX
+#define BENCH_UNIT	"ns"
+/* CLOCK_MONOTONIC of the host, see host_clock.c */
+uint64_t bench_host_ns(void);
+static inline uint32_t bench_now(void){
+	return (uint32_t)bench_host_ns();
+}
+#else
+#define BENCH_UNIT	"cycles"
+static inline uint32_t bench_now(void){
+	return k_cycle_get_32();
+}
+#endif
+
+/**
+ * @brief Guitar controls, as decoded by the driver
+ *
+ */
+struct bench_input{
+	uint32_t buttons;
+	uint8_t axes[3];
+};
+
+static struct bench_input inputs[PATTERN_LEN];
+static struct wii_btn_data frames[PATTERN_LEN];
+static uint32_t samples[BENCH_SAMPLES];
+
+static const struct device *wii = DEVICE_DT_GET(DT_NODELABEL(wii_guitar));
+static const struct emul *wii_emul;
+
+K_MSGQ_DEFINE(bench_slots, sizeof(uint8_t), 4, 1);
+
+/**
+ * @brief Raw frame the guitar sends for `input` (buttons are active low)
+ *
+ */
+static void bench_frame(const struct bench_input * input, struct wii_btn_data * frame){
+	uint32_t b = input->buttons;
+	frame->raw[0] = input->axes[0] & 0x3f;
+	frame->raw[1] = input->axes[1] & 0x3f;
+	frame->raw[2] = 0x00;
+	frame->raw[3] = input->axes[2] & 0x1f;
+	frame->raw[4] = ~((((b >> 5) & 1) << 2) | (((b >> 6) & 1) << 4) | (((b >> 8) & 1) << 6));
+	frame->raw[5] = ~(((b >> 7) & 1) | ((b & 0x1f) << 3));
+}
+
+/**
+ * @brief A player walking chords up the neck, strumming down and up
+ * on every chord, with the whammy bar swept and the stick at rest.
+ *
+ */
+static void bench_pattern(void){
+	static const uint8_t chords[] = {0x01, 0x03, 0x02, 0x06, 0x04, 0x0c, 0x08, 0x18};
+	for (int i = 0; i < PATTERN_LEN; i++){
+		struct bench_input * input = &inputs[i];
+		input->buttons = chords[(i / 4) % ARRAY_SIZE(chords)];
+		if (i % 4 == 1){
+			input->buttons |= BIT(8);
+		}
+		else if (i % 4 == 3){
+			input->buttons |= BIT(7);
+		}
+		input->axes[0] = 0x20;
+		input->axes[1] = 0x20;
+		input->axes[2] = 0x10 + (i % 16);
+		bench_frame(input, &frames[i]);
+	}
+}
+
+static void bench_sort(uint32_t * values, size_t n){
+	for (size_t i = 1; i < n; i++){
+		uint32_t v = values[i];
+		size_t j = i;
+		while (j > 0 && values[j - 1] > v){
+			values[j] = values[j - 1];
+			j--;
+		}
+		values[j] = v;
+	}
+}
+
+static void bench_report(const char * stage){
+	bench_sort(samples, BENCH_SAMPLES);
+	TC_PRINT("BENCH %s unit=%s n=%ux%u min=%u median=%u max=%u\n", stage, BENCH_UNIT,
+		BENCH_SAMPLES, BENCH_BATCH, samples[0], samples[BENCH_SAMPLES / 2],
+		samples[BENCH_SAMPLES - 1]);
+	/* Every batch does work, so a clock which does not move while code runs
+	(too coarse, or stopped) would only print zeroes */
+	zassert_true(samples[0] > 0, "%s: the clock did not move", stage);
+}
+
+/**
+ * @brief Time BENCH_BATCH runs of `body`, with `i` indexing the input pattern,
+ * BENCH_SAMPLES times, and print the statistics of `stage`.
+ *
+ */
+#define BENCH(stage, body) do { \
+		for (int s = 0; s < BENCH_SAMPLES; s++){ \
+			uint32_t start = bench_now(); \
+			for (int n = 0; n < BENCH_BATCH; n++){ \
+				const int i = (s + n) % PATTERN_LEN; \
+				ARG_UNUSED(i); \
+				body; \
+			} \
+			samples[s] = (bench_now() - start) / BENCH_BATCH; \
+		} \
+		bench_report(stage); \
+	} while (0)
+
+static inline void bench_encode(const struct gamepad_layout * layout, uint8_t * report,
+	const struct bench_input * input){
+	gamepad_report_clear(layout, report);
+	gamepad_report_set_buttons(layout, report, input->buttons);
+	gamepad_report_set_axis(layout, report, 0, input->axes[0], 6);
+	gamepad_report_set_axis(layout, report, 1, input->axes[1], 6);
+	gamepad_report_set_axis(layout, report, 2, input->axes[2], 5);
+}
+
+static void test_report_encode(void){
+	static volatile uint8_t sink;
+	uint8_t report[GAMEPAD_REPORT_SIZE(ALIGNED)];
+	BENCH("report_encode_aligned", {
+		bench_encode(&layout_aligned, report, &inputs[i]);
+		sink = report[0];
+	});
+	BENCH("report_encode_packed", {
+		bench_encode(&layout_packed, report, &inputs[i]);
+		sink = report[0];
+	});
+	/* The tilt sensor, merged into the last button */
+	BENCH("report_set_button", {
+		gamepad_report_set_button(&layout_packed, report, 9, i & 1);
+		sink = report[1];
+	});
+}
+
+/**
+ * @brief Reports used to be compared to the previous one before being
+ * queued. Kept as a reference for the change mask which replaced it.
+ */
+static void test_report_compare(void){
+	static volatile bool sink;
+	static uint8_t reports[PATTERN_LEN][GAMEPAD_REPORT_SIZE(PACKED)];
+	for (int i = 0; i < PATTERN_LEN; i++){
+		bench_encode(&layout_packed, reports[i], &inputs[i]);
+	}
+	BENCH("report_memcmp", {
+		sink = memcmp(reports[i], reports[(i + 1) % PATTERN_LEN], layout_packed.size) != 0;
+	});
+}
+
+/**
+ * @brief Hand a report slot over to the reporting thread and take it
+ * back, as hid_report_commit() and the reporting thread do.
+ */
+static void test_slot_handoff(void){
+	BENCH("slot_handoff", {
+		uint8_t slot = i & 0x3;
+		k_msgq_put(&bench_slots, &slot, K_NO_WAIT);
+		k_msgq_get(&bench_slots, &slot, K_NO_WAIT);
+	});
+}
+
+/**
+ * @brief The bus transfer alone, then with the decode into the report.
+ * The difference is the cost of decoding a frame.
+ */
+static void test_wii(void){
+	uint8_t report[GAMEPAD_REPORT_SIZE(PACKED)];
+	struct wii_btn_data frame;
+	uint32_t changed;
+	wii_emul = emul_get_binding(DT_LABEL(DT_NODELABEL(wii_guitar)));
+	zassert_not_null(wii_emul, "no emulator");
+	zassert_true(device_is_ready(wii), "wii peripheral not ready");
+	zassert_ok(gamepad_read(wii, &layout_packed, report, &changed), NULL);
+	BENCH("wii_fetch", {
+		wii_emul_set_frame(wii_emul, &frames[i]);
+		wii_peripheral_fetch(wii, &frame);
+	});
+	struct wii_emul_stats stats;
+	wii_emul_reset_stats(wii_emul);
+	for (int i = 0; i < PATTERN_LEN; i++){
+		wii_emul_set_frame(wii_emul, &frames[i]);
+		wii_peripheral_fetch(wii, &frame);
+	}
+	wii_emul_get_stats(wii_emul, &stats);
+	zassert_equal(stats.not_ready, 0, "frames were read before they were ready");
+	TC_PRINT("BUS %s transactions=%u bytes=%u ns=%u wait_ns=%u fetch_ns=%u\n",
+		stats.transactions == PATTERN_LEN ? "single_transaction" : "delayed",
+		stats.transactions / PATTERN_LEN, stats.bytes / PATTERN_LEN,
+		(uint32_t)(stats.bus_ns / PATTERN_LEN), (uint32_t)(stats.wait_ns / PATTERN_LEN),
+		(uint32_t)((stats.bus_ns + stats.wait_ns) / PATTERN_LEN));
+	BENCH("wii_read", {
+		wii_emul_set_frame(wii_emul, &frames[i]);
+		gamepad_read(wii, &layout_packed, report, &changed);
+	});
+	/* Check that the pattern decodes as expected, the benchmark would be moot otherwise */
+	uint8_t expected[GAMEPAD_REPORT_SIZE(PACKED)];
+	for (int i = 0; i < PATTERN_LEN; i++){
+		wii_emul_set_frame(wii_emul, &frames[i]);
+		zassert_ok(gamepad_read(wii, &layout_packed, report, &changed), NULL);
+		bench_encode(&layout_packed, expected, &inputs[i]);
+		zassert_mem_equal(report, expected, sizeof(report), "input %d decoded wrong", i);
+	}
+}
+
+/* Read from the fetching thread, which may run in user mode */
+ZTEST_DMEM static const struct device *fetch_devs[BENCH_FETCH_BATCH];
+ZTEST_BMEM static struct wii_frame fetch_frames[BENCH_FETCH_BATCH];
+
+K_THREAD_STACK_DEFINE(fetch_stack, 1024);
+static struct k_thread fetch_thread;
+K_SEM_DEFINE(fetch_go, 0, 1);
+K_SEM_DEFINE(fetch_done, 0, 1);
+
+/**
+ * @brief Fetch BENCH_BATCH frames whenever `fetch_go` is given, in batches
+ * if `p1` is set, then give `fetch_done`
+ *
+ */
+static void fetch_entry(void *p1, void *p2, void *p3){
+	const bool batched = (bool)(uintptr_t)p1;
+	for (int s = 0; s < BENCH_SAMPLES; s++){
+		k_sem_take(&fetch_go, K_FOREVER);
+		if (batched){
+			for (int n = 0; n < BENCH_BATCH; n += BENCH_FETCH_BATCH){
+				wii_peripheral_fetch_batch(fetch_devs, fetch_frames,
+					MIN(BENCH_FETCH_BATCH, BENCH_BATCH - n));
+			}
+		}
+		else {
+			for (int n = 0; n < BENCH_BATCH; n++){
+				wii_peripheral_fetch(fetch_devs[0], &fetch_frames[n % BENCH_FETCH_BATCH].data);
+			}
+		}
+		k_sem_give(&fetch_done);
+	}
+}
+
+/**
+ * @brief Time the fetches of fetch_entry() from a thread created with `options`.
+ * The cost of waking the thread up is spread over BENCH_BATCH frames, and is
+ * the same for every variant.
+ *
+ */
+static uint32_t bench_fetch_thread(const char * stage, bool batched, uint32_t options){
+	k_thread_create(&fetch_thread, fetch_stack, K_THREAD_STACK_SIZEOF(fetch_stack),
+		fetch_entry, (void *)(uintptr_t)batched, NULL, NULL,
+		k_thread_priority_get(k_current_get()), options, K_FOREVER);
+	k_thread_access_grant(&fetch_thread, wii, &fetch_go, &fetch_done);
+	k_thread_start(&fetch_thread);
+	for (int s = 0; s < BENCH_SAMPLES; s++){
+		uint32_t start = bench_now();
+		k_sem_give(&fetch_go);
+		k_sem_take(&fetch_done, K_FOREVER);
+		samples[s] = (bench_now() - start) / BENCH_BATCH;
+	}
+	zassert_ok(k_thread_join(&fetch_thread, K_FOREVER), NULL);
+	bench_report(stage);
+	for (int i = 0; batched && i < BENCH_FETCH_BATCH; i++){
+		zassert_ok(fetch_frames[i].err, "frame %d was not fetched", i);
+	}
+	return samples[BENCH_SAMPLES / 2];
+}
+
+static void test_wii_fetch_thread(void){
+	for (int i = 0; i < BENCH_FETCH_BATCH; i++){
+		fetch_devs[i] = wii;
+		fetch_frames[i].err = -ENODATA;
+	}
+	wii_emul_set_frame(wii_emul, &frames[0]);
+	uint32_t single = bench_fetch_thread("wii_fetch_thread", false, 0);
+	uint32_t batch = bench_fetch_thread("wii_fetch_batch_thread", true, 0);
+#ifdef CONFIG_USERSPACE
+	uint32_t single_user = bench_fetch_thread("wii_fetch_user", false, K_USER);
+	uint32_t batch_user = bench_fetch_thread("wii_fetch_batch_user", true, K_USER);
+	/* Signed, a difference below the noise may come out negative */
+	TC_PRINT("SYSCALL unit=%s single=%d batch=%d\n", BENCH_UNIT,
+		(int32_t)(single_user - single), (int32_t)(batch_user - batch));
+#else
+	ARG_UNUSED(single);
+	ARG_UNUSED(batch);
+#endif
+}
+
+void test_main(void)
+{
+	bench_pattern();
+	ztest_test_suite(benchmark,
+			 ztest_unit_test(test_report_encode),
+			 ztest_unit_test(test_report_compare),
+			 ztest_unit_test(test_slot_handoff),
+			 ztest_unit_test(test_wii),
+			 ztest_unit_test(test_wii_fetch_thread)
+			 );
+
+	ztest_run_test_suite(benchmark);
+}
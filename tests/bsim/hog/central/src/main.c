@@ -0,0 +1,215 @@
+/**
+ * @file main.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Subscribes to the shredlink HID over GATT report and measures
+ * notification rate, sample-to-arrival latency and press edges.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include <zephyr.h>
+#include <sys/byteorder.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/gatt.h>
+#include <bluetooth/uuid.h>
+#include "../../pattern.h"
+
+/* Latency histogram in 100us bins */
+#define HIST_BIN_US		100
+#define HIST_BINS		1000
+
+static struct bt_conn *default_conn;
+static struct bt_uuid_16 discover_uuid = BT_UUID_INIT_16(0);
+static struct bt_gatt_discover_params discover_params;
+static struct bt_gatt_subscribe_params subscribe_params;
+
+static struct {
+	uint32_t hist[HIST_BINS];
+	uint32_t count;
+	uint32_t max_us;
+	uint32_t edges;
+	int64_t first_ms;
+	int64_t last_ms;
+	bool pressed;
+} results;
+
+static uint8_t notify_func(struct bt_conn *conn,
+			   struct bt_gatt_subscribe_params *params,
+			   const void *data, uint16_t length)
+{
+	if (!data) {
+		params->value_handle = 0U;
+		return BT_GATT_ITER_STOP;
+	}
+	if (length < PATTERN_REPORT_SIZE) {
+		return BT_GATT_ITER_CONTINUE;
+	}
+	const uint8_t *report = data;
+	uint32_t latency_us = ((pattern_now() - sys_get_le24(&report[1])) & PATTERN_TS_MASK) *
+		PATTERN_TS_UNIT_US;
+	bool pressed = report[0] & BIT(0);
+
+	if (results.count == 0) {
+		results.first_ms = k_uptime_get();
+	}
+	results.last_ms = k_uptime_get();
+	results.count++;
+	results.hist[MIN(latency_us / HIST_BIN_US, HIST_BINS - 1)]++;
+	results.max_us = MAX(results.max_us, latency_us);
+	if (pressed && !results.pressed) {
+		results.edges++;
+	}
+	results.pressed = pressed;
+	return BT_GATT_ITER_CONTINUE;
+}
+
+static uint8_t discover_func(struct bt_conn *conn,
+			     const struct bt_gatt_attr *attr,
+			     struct bt_gatt_discover_params *params)
+{
+	int err;
+
+	if (!attr) {
+		printk("Discover complete\n");
+		(void)memset(params, 0, sizeof(*params));
+		return BT_GATT_ITER_STOP;
+	}
+
+	if (!bt_uuid_cmp(discover_params.uuid, BT_UUID_HIDS)) {
+		memcpy(&discover_uuid, BT_UUID_HIDS_REPORT, sizeof(discover_uuid));
+		discover_params.uuid = &discover_uuid.uuid;
+		discover_params.start_handle = attr->handle + 1;
+		discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+	} else if (!bt_uuid_cmp(discover_params.uuid, BT_UUID_HIDS_REPORT)) {
+		memcpy(&discover_uuid, BT_UUID_GATT_CCC, sizeof(discover_uuid));
+		discover_params.uuid = &discover_uuid.uuid;
+		discover_params.start_handle = attr->handle + 2;
+		discover_params.type = BT_GATT_DISCOVER_DESCRIPTOR;
+		subscribe_params.value_handle = bt_gatt_attr_value_handle(attr);
+	} else {
+		subscribe_params.notify = notify_func;
+		subscribe_params.value = BT_GATT_CCC_NOTIFY;
+		subscribe_params.ccc_handle = attr->handle;
+
+		err = bt_gatt_subscribe(conn, &subscribe_params);
+		if (err && err != -EALREADY) {
+			printk("Subscribe failed (err %d)\n", err);
+		}
+		return BT_GATT_ITER_STOP;
+	}
+
+	err = bt_gatt_discover(conn, &discover_params);
+	if (err) {
+		printk("Discover failed (err %d)\n", err);
+	}
+	return BT_GATT_ITER_STOP;
+}
+
+static bool eir_found(struct bt_data *data, void *user_data)
+{
+	bt_addr_le_t *addr = user_data;
+
+	if (data->type != BT_DATA_UUID16_SOME && data->type != BT_DATA_UUID16_ALL) {
+		return true;
+	}
+	for (int i = 0; i + sizeof(uint16_t) <= data->data_len; i += sizeof(uint16_t)) {
+		if (sys_get_le16(&data->data[i]) != BT_UUID_HIDS_VAL) {
+			continue;
+		}
+		if (bt_le_scan_stop()) {
+			return false;
+		}
+		int err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN,
+					    BT_LE_CONN_PARAM(6, 6, 0, 400), &default_conn);
+		if (err) {
+			printk("Create connection failed (err %d)\n", err);
+		}
+		return false;
+	}
+	return true;
+}
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+			 struct net_buf_simple *ad)
+{
+	if (type == BT_GAP_ADV_TYPE_ADV_IND) {
+		bt_data_parse(ad, eir_found, (void *)addr);
+	}
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	if (err) {
+		printk("Connection failed (err %u)\n", err);
+		return;
+	}
+	memcpy(&discover_uuid, BT_UUID_HIDS, sizeof(discover_uuid));
+	discover_params.uuid = &discover_uuid.uuid;
+	discover_params.func = discover_func;
+	discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+	discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+	discover_params.type = BT_GATT_DISCOVER_PRIMARY;
+
+	err = bt_gatt_discover(conn, &discover_params);
+	if (err) {
+		printk("Discover failed (err %d)\n", err);
+	}
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	printk("Disconnected (reason 0x%02x)\n", reason);
+	bt_conn_unref(default_conn);
+	default_conn = NULL;
+}
+
+BT_CONN_CB_DEFINE(conn_callbacks) = {
+	.connected = connected,
+	.disconnected = disconnected,
+};
+
+static uint32_t percentile(uint32_t pct)
+{
+	uint32_t target = (results.count * pct + 99) / 100;
+	uint32_t seen = 0;
+
+	for (int i = 0; i < HIST_BINS; i++) {
+		seen += results.hist[i];
+		if (seen >= target) {
+			return (i + 1) * HIST_BIN_US;
+		}
+	}
+	return HIST_BINS * HIST_BIN_US;
+}
+
+void main(void)
+{
+	int err = bt_enable(NULL);
+
+	if (err) {
+		printk("Bluetooth init failed (err %d)\n", err);
+		return;
+	}
+	err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, device_found);
+	if (err) {
+		printk("Scanning failed to start (err %d)\n", err);
+		return;
+	}
+
+	k_msleep(PATTERN_REPORT_MS - k_uptime_get());
+	if (results.count == 0) {
+		printk("hog central: FAIL no notifications received\n");
+		return;
+	}
+	int64_t window = MAX(results.last_ms - results.first_ms, 1);
+	printk("hog central: notifications %u (%u/s)\n", results.count,
+	       (uint32_t)(results.count * MSEC_PER_SEC / window));
+	printk("hog central: latency p50 %u us, p90 %u us, p99 %u us, max %u us\n",
+	       percentile(50), percentile(90), percentile(99), results.max_us);
+	printk("hog central: presses %u\n", results.edges);
+}
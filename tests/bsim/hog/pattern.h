@@ -0,0 +1,39 @@
+/**
+ * @file pattern.h
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Input pattern shared by the HID over GATT simulation peripheral and central
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Every simulated device shares the same timeline, so the central can
+ * compute latency directly from the sample timestamp in the report.
+ */
+
+#ifndef __SHREDLINK_BSIM_HOG_PATTERN_H
+#define __SHREDLINK_BSIM_HOG_PATTERN_H
+
+#include <zephyr.h>
+
+/* Report: byte 0 buttons, bytes 1-3 the sample time (little endian) */
+#define PATTERN_REPORT_SIZE		4
+#define PATTERN_TS_UNIT_US		10
+#define PATTERN_TS_MASK			0xffffff
+
+/* Sampled at the rate the application polls the controller */
+#define PATTERN_SAMPLE_US		714
+/* Strum presses shorter than a connection interval, to exercise edge merging */
+#define PATTERN_PRESS_PERIOD_US	25000
+#define PATTERN_PRESS_US		3000
+
+/* Input stops at PATTERN_STOP_MS, results are printed at PATTERN_REPORT_MS */
+#define PATTERN_STOP_MS			14000
+#define PATTERN_REPORT_MS		15000
+
+static inline uint32_t pattern_now(void){
+	return (uint32_t)(k_ticks_to_us_floor64(k_uptime_ticks()) / PATTERN_TS_UNIT_US) & PATTERN_TS_MASK;
+}
+
+#endif
@@ -0,0 +1,54 @@
+/**
+ * @file main.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @brief Drives the HID over GATT output with a synthetic input pattern
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include <zephyr.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+#include <shredlink/hog.h>
+#include <shredlink/report.h>
+#include "../../pattern.h"
+
+LOG_MODULE_REGISTER(shredlink, CONFIG_SHREDLINK_LOG_LEVEL);
+
+BUILD_ASSERT(GAMEPAD_REPORT_SIZE(DT_NODELABEL(gamepad0)) == PATTERN_REPORT_SIZE,
+	"gamepad0 does not match the pattern report layout");
+
+void main(void)
+{
+	uint8_t report[PATTERN_REPORT_SIZE];
+	uint32_t presses = 0;
+	bool pressed = false;
+
+	/* Presses before the central subscribed would be merged into one */
+	while (!hog_subscribed()){
+		k_msleep(1);
+	}
+	while (k_uptime_get() < PATTERN_STOP_MS){
+		uint32_t now_us = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+		bool press = (now_us % PATTERN_PRESS_PERIOD_US) < PATTERN_PRESS_US;
+		if (press && !pressed){
+			presses++;
+		}
+		pressed = press;
+		report[0] = press;
+		sys_put_le24(pattern_now(), &report[1]);
+		hog_submit_report(report);
+		k_usleep(PATTERN_SAMPLE_US);
+	}
+	/* Release everything so the last press is complete */
+	report[0] = 0;
+	sys_put_le24(pattern_now(), &report[1]);
+	hog_submit_report(report);
+
+	k_msleep(PATTERN_REPORT_MS - k_uptime_get());
+	printk("hog peripheral: presses %u\n", presses);
+}
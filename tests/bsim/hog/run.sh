@@ -0,0 +1,33 @@
+#!/usr/bin/env bash
+# Copyright (c) 2026 Brian Bradley
+# SPDX-License-Identifier: Apache-2.0
+#
+# Runs the HID over GATT output against a central on the BabbleSim simulated
+# radio, and prints the notification rate, latency percentiles and whether
+# any strum press was lost on the way.
+#
+# Requires BSIM_OUT_PATH and BSIM_COMPONENTS_PATH (see the Zephyr bsim docs).
+
+set -e
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must point to the BabbleSim build}"
+HERE=$(cd "$(dirname "$0")" && pwd)
+BUILD=${HERE}/build
+SIM_ID=shredlink_hog
+
+west build -p auto -b nrf52_bsim -d "${BUILD}/peripheral" "${HERE}/peripheral"
+west build -p auto -b nrf52_bsim -d "${BUILD}/central" "${HERE}/central"
+
+cd "${BSIM_OUT_PATH}/bin"
+"${BUILD}/peripheral/zephyr/zephyr.exe" -s=${SIM_ID} -d=0 > "${BUILD}/peripheral.log" 2>&1 &
+"${BUILD}/central/zephyr/zephyr.exe" -s=${SIM_ID} -d=1 > "${BUILD}/central.log" 2>&1 &
+./bs_2G4_phy_v1 -s=${SIM_ID} -D=2 -sim_length=16e6 > /dev/null
+wait
+
+grep "hog:" "${BUILD}/peripheral.log" | tail -n 3
+grep "hog central:" "${BUILD}/central.log"
+
+expected=$(sed -n 's/.*hog peripheral: presses \([0-9]*\).*/\1/p' "${BUILD}/peripheral.log")
+seen=$(sed -n 's/.*hog central: presses \([0-9]*\).*/\1/p' "${BUILD}/central.log")
+echo "presses sent ${expected}, received ${seen}"
+test -n "${expected}" && test "${expected}" = "${seen}"
@@ -0,0 +1,138 @@
+/**
+ * @file main.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include <zephyr.h>
+#include <ztest.h>
+#include <drivers/gpio.h>
+#include <drivers/gpio/gpio_emul.h>
+#include <drivers/gamepad.h>
+
+#define GAMEPAD	DT_NODELABEL(gpio_gamepad)
+#define BUTTON_PORT(idx)	DEVICE_DT_GET(DT_GPIO_CTLR_BY_IDX(GAMEPAD, button_gpios, idx))
+#define BUTTON_PIN(idx)		DT_GPIO_PIN_BY_IDX(GAMEPAD, button_gpios, idx)
+#define BUTTON_ACTIVE_LOW(idx)	(DT_GPIO_FLAGS_BY_IDX(GAMEPAD, button_gpios, idx) & GPIO_ACTIVE_LOW)
+#define BUTTONS	DT_PROP_LEN(GAMEPAD, button_gpios)
+
+static const struct device *gamepad = DEVICE_DT_GET(GAMEPAD);
+
+/* Room for one more button than the gamepad has, which must stay clear */
+static const struct gamepad_layout layout = {
+	.size = 1,
+	.buttons = BUTTONS + 1,
+};
+
+#define BUTTON_ENTRY(node_id, prop, idx) \
+	{ BUTTON_PORT(idx), BUTTON_PIN(idx), BUTTON_ACTIVE_LOW(idx) },
+
+static const struct {
+	const struct device *port;
+	gpio_pin_t pin;
+	bool active_low;
+} buttons[] = {
+	DT_FOREACH_PROP_ELEM(GAMEPAD, button_gpios, BUTTON_ENTRY)
+};
+
+static void press(int button, bool pressed){
+	gpio_emul_input_set(buttons[button].port, buttons[button].pin,
+		pressed != buttons[button].active_low);
+}
+
+static void release_all(void){
+	for (int i = 0; i < ARRAY_SIZE(buttons); i++){
+		press(i, false);
+	}
+}
+
+static uint8_t read_report(uint32_t * changed){
+	uint8_t report = 0xff;
+	zassert_ok(gamepad_read(gamepad, &layout, &report, changed), "read failed");
+	return report;
+}
+
+static void test_idle(void){
+	uint32_t changed;
+	release_all();
+	zassert_true(device_is_ready(gamepad), "gamepad not ready");
+	zassert_equal(read_report(&changed), 0x00, "no button should be pressed");
+	zassert_equal(read_report(&changed), 0x00, NULL);
+	zassert_equal(changed, 0, "nothing changed");
+}
+
+static void test_buttons(void){
+	uint32_t changed;
+	release_all();
+	read_report(&changed);
+	/* One button from each run, across both ports */
+	press(0, true);
+	press(4, true);
+	press(5, true);
+	zassert_equal(read_report(&changed), 0x31, "unexpected report");
+	zassert_equal(changed, GAMEPAD_CHANGED_BUTTONS, NULL);
+	zassert_equal(read_report(&changed), 0x31, NULL);
+	zassert_equal(changed, 0, "nothing changed");
+	for (int i = 0; i < BUTTONS; i++){
+		release_all();
+		press(i, true);
+		zassert_equal(read_report(&changed), BIT(i), "button %d", i);
+	}
+}
+
+static void test_unused_pins(void){
+	uint32_t changed;
+	release_all();
+	read_report(&changed);
+	/* Pins between and beside the buttons are not part of the gamepad */
+	zassert_ok(gpio_pin_configure(buttons[0].port, 6, GPIO_INPUT), NULL);
+	zassert_ok(gpio_pin_configure(buttons[3].port, 2, GPIO_INPUT), NULL);
+	gpio_emul_input_set(buttons[0].port, 6, 0);
+	gpio_emul_input_set(buttons[0].port, 6, 1);
+	gpio_emul_input_set(buttons[3].port, 2, 1);
+	zassert_equal(read_report(&changed), 0x00, NULL);
+	zassert_equal(changed, 0, "unused pins must not be reported");
+	gpio_emul_input_set(buttons[3].port, 2, 0);
+}
+
+#ifdef CONFIG_GPIO_GAMEPAD_TRIGGER
+static volatile int triggers;
+
+static void on_change(const struct device *dev){
+	zassert_equal_ptr(dev, gamepad, NULL);
+	triggers++;
+}
+
+static void test_trigger(void){
+	release_all();
+	triggers = 0;
+	zassert_ok(gamepad_trigger_set(gamepad, on_change), NULL);
+	press(1, true);
+	press(1, false);
+	press(3, true);
+	zassert_equal(triggers, 3, "every edge should trigger");
+	zassert_ok(gamepad_trigger_set(gamepad, NULL), NULL);
+	press(3, false);
+	zassert_equal(triggers, 3, "no trigger once the handler is removed");
+}
+#else
+static void test_trigger(void){
+	zassert_equal(gamepad_trigger_set(gamepad, NULL), -ENOTSUP, NULL);
+}
+#endif
+
+void test_main(void)
+{
+	ztest_test_suite(gpio_gamepad_tests,
+		ztest_unit_test(test_idle),
+		ztest_unit_test(test_buttons),
+		ztest_unit_test(test_unused_pins),
+		ztest_unit_test(test_trigger)
+	);
+	ztest_run_test_suite(gpio_gamepad_tests);
+}
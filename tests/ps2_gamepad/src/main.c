@@ -0,0 +1,172 @@
+/**
+ * @file main.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include <errno.h>
+#include <zephyr.h>
+#include <ztest.h>
+#include <drivers/gamepad.h>
+#include <ps2.h>
+#include <ps2_emul.h>
+
+#define BENCH_READS	1000
+
+static const struct device *gamepad = DEVICE_DT_GET(DT_NODELABEL(ps2));
+static const struct emul *emul;
+
+/* Buttons only: the controller should stay in digital mode */
+static const struct gamepad_layout layout_digital = {
+	.size = 2,
+	.buttons = 16,
+};
+
+/* Both sticks, 8 bits each */
+static const struct gamepad_layout layout_analog = {
+	.size = 6,
+	.buttons = 16,
+	.axes = 4,
+	.axis = {{16, 8, 8}, {24, 8, 8}, {32, 8, 8}, {40, 8, 8}},
+};
+
+static void reattach(void){
+	uint8_t report[6];
+	uint32_t changed;
+	/* A failed read drops the controller, the next one attaches it again */
+	ps2_emul_set_connected(emul, false);
+	zassert_not_equal(gamepad_read(gamepad, &layout_digital, report, &changed), 0,
+		"read should fail without a controller");
+	ps2_emul_set_connected(emul, true);
+}
+
+static void test_clock(void){
+	struct ps2_emul_stats stats;
+	uint8_t report[2];
+	uint32_t changed;
+	emul = emul_get_binding(DT_LABEL(DT_NODELABEL(ps2)));
+	zassert_not_null(emul, "no emulator");
+	zassert_true(device_is_ready(gamepad), "gamepad not ready");
+	/* 1 MHz and 500 kHz are too fast for this controller */
+	ps2_emul_set_max_frequency(emul, 250000);
+	zassert_ok(gamepad_read(gamepad, &layout_digital, report, &changed), NULL);
+	zassert_equal(changed, GAMEPAD_CHANGED_ALL, "first read reports everything");
+	ps2_emul_get_stats(emul, &stats);
+	zassert_equal(stats.frequency, 250000, "expected the fastest reliable clock");
+	zassert_equal(stats.mode_id, PS2_ID_DIGITAL, NULL);
+
+	ps2_emul_set_max_frequency(emul, 1000000);
+	reattach();
+	zassert_ok(gamepad_read(gamepad, &layout_digital, report, &changed), NULL);
+	ps2_emul_get_stats(emul, &stats);
+	zassert_equal(stats.frequency, 1000000, "expected spi-max-frequency");
+}
+
+static void test_digital(void){
+	struct ps2_emul_stats stats;
+	uint8_t report[2];
+	uint32_t changed;
+	ps2_emul_set_buttons(emul, PS2_BTN_R2 | PS2_BTN_DOWN);
+	ps2_emul_reset_stats(emul);
+	zassert_ok(gamepad_read(gamepad, &layout_digital, report, &changed), NULL);
+	ps2_emul_get_stats(emul, &stats);
+	zassert_equal(stats.transfers, 1, "a read is a single transfer");
+	zassert_equal(stats.bytes, PS2_DIGITAL_FRAME, "digital replies are the shortest");
+	/* Green fret and strum down */
+	zassert_equal(report[0], 0x01, NULL);
+	zassert_equal(report[1], 0x01, NULL);
+	zassert_equal(changed, GAMEPAD_CHANGED_BUTTONS, NULL);
+	zassert_ok(gamepad_read(gamepad, &layout_digital, report, &changed), NULL);
+	zassert_equal(changed, 0, "nothing changed");
+	ps2_emul_set_buttons(emul, 0);
+}
+
+static void test_analog(void){
+	struct ps2_emul_stats stats;
+	uint8_t report[6];
+	uint32_t changed;
+	const uint8_t sticks[4] = {0x11, 0x22, 0x33, 0x44};
+	ps2_emul_set_sticks(emul, sticks);
+	/* Asking for axes switches the controller to analog mode */
+	zassert_ok(gamepad_read(gamepad, &layout_analog, report, &changed), NULL);
+	ps2_emul_get_stats(emul, &stats);
+	zassert_equal(stats.mode_id, PS2_ID_ANALOG, NULL);
+	zassert_equal(report[2], 0x33, "left x");
+	zassert_equal(report[3], 0x44, "left y");
+	zassert_equal(report[4], 0x11, "right x");
+	zassert_equal(report[5], 0x22, "right y");
+	ps2_emul_reset_stats(emul);
+	zassert_ok(gamepad_read(gamepad, &layout_analog, report, &changed), NULL);
+	ps2_emul_get_stats(emul, &stats);
+	zassert_equal(stats.bytes, PS2_ANALOG_FRAME, NULL);
+	zassert_equal(changed, 0, "nothing changed");
+}
+
+static void test_unplug(void){
+	uint8_t report[2];
+	uint32_t changed;
+	reattach();
+	zassert_ok(gamepad_read(gamepad, &layout_digital, report, &changed), NULL);
+	zassert_equal(changed, GAMEPAD_CHANGED_ALL, "a new controller reports everything");
+}
+
+static void test_attach_interval(void){
+	struct ps2_emul_stats stats;
+	uint8_t report[2];
+	uint32_t changed;
+	ps2_emul_set_connected(emul, false);
+	/* Drops the controller, then fails to attach it again */
+	zassert_not_equal(gamepad_read(gamepad, &layout_digital, report, &changed), 0, NULL);
+	zassert_equal(gamepad_read(gamepad, &layout_digital, report, &changed), -ENODEV, NULL);
+	ps2_emul_reset_stats(emul);
+	ps2_emul_set_connected(emul, true);
+	zassert_equal(gamepad_read(gamepad, &layout_digital, report, &changed), -ENODEV,
+		"attaching should wait for the interval");
+	ps2_emul_get_stats(emul, &stats);
+	zassert_equal(stats.transfers, 0, "nothing should reach the bus in between");
+	k_msleep(CONFIG_PS2_GAMEPAD_ATTACH_INTERVAL_MS);
+	zassert_ok(gamepad_read(gamepad, &layout_digital, report, &changed), NULL);
+	zassert_equal(changed, GAMEPAD_CHANGED_ALL, NULL);
+}
+
+static void bench(const char *name, const struct gamepad_layout *layout){
+	struct ps2_emul_stats stats;
+	uint8_t report[6];
+	uint32_t changed;
+	zassert_ok(gamepad_read(gamepad, layout, report, &changed), NULL);
+	ps2_emul_reset_stats(emul);
+	uint32_t start = k_cycle_get_32();
+	for (int i = 0; i < BENCH_READS; i++){
+		gamepad_read(gamepad, layout, report, &changed);
+	}
+	uint32_t cycles = k_cycle_get_32() - start;
+	ps2_emul_get_stats(emul, &stats);
+	TC_PRINT("ps2 %s: %u bytes/read, %u ns bus/read at %u Hz, %u cycles/read\n", name,
+		stats.bytes / BENCH_READS, (uint32_t)(stats.bus_ns / BENCH_READS),
+		stats.frequency, cycles / BENCH_READS);
+}
+
+static void test_bench(void){
+	ps2_emul_set_max_frequency(emul, 250000);
+	reattach();
+	bench("digital", &layout_digital);
+	bench("analog", &layout_analog);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(ps2_gamepad_tests,
+		ztest_unit_test(test_clock),
+		ztest_unit_test(test_digital),
+		ztest_unit_test(test_analog),
+		ztest_unit_test(test_unplug),
+		ztest_unit_test(test_attach_interval),
+		ztest_unit_test(test_bench)
+	);
+	ztest_run_test_suite(ps2_gamepad_tests);
+}
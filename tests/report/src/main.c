@@ -0,0 +1,185 @@
+/**
+ * @file main.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include <zephyr.h>
+#include <ztest.h>
+#include <shredlink/report.h>
+
+#define ALIGNED	DT_NODELABEL(gamepad_aligned)
+#define PACKED	DT_NODELABEL(gamepad_packed)
+#define EVEN	DT_NODELABEL(gamepad_even)
+
+GAMEPAD_LAYOUT_CHECK(ALIGNED)
+GAMEPAD_LAYOUT_CHECK(PACKED)
+GAMEPAD_LAYOUT_CHECK(EVEN)
+
+static const struct gamepad_layout layout_aligned = GAMEPAD_LAYOUT_INIT(ALIGNED);
+static const struct gamepad_layout layout_packed = GAMEPAD_LAYOUT_INIT(PACKED);
+static const struct gamepad_layout layout_even = GAMEPAD_LAYOUT_INIT(EVEN);
+
+static const uint8_t desc_aligned[] = { GAMEPAD_HID_REPORT_DESC(ALIGNED) };
+static const uint8_t desc_even[] = { GAMEPAD_HID_REPORT_DESC(EVEN) };
+
+/* Reports only grow with CONFIG_SHREDLINK_REPORT_TIMESTAMP */
+#define STAMP	GAMEPAD_STAMP_SIZE
+
+static void test_report_size(void){
+	zassert_equal(GAMEPAD_REPORT_SIZE(ALIGNED), 5 + STAMP, "byte aligned report should be 5 bytes");
+	zassert_equal(GAMEPAD_REPORT_SIZE(PACKED), 4 + STAMP, "bit packed report should be 4 bytes");
+	zassert_equal(GAMEPAD_REPORT_SIZE(EVEN), 2 + STAMP, "8 buttons and an 8 bit axis should be 2 bytes");
+}
+
+/**
+ * @brief Fill a report the way a gamepad backend would, from controls
+ * with the resolution of the guitar (6, 6 and 5 bit axes)
+ */
+static void fill_report(const struct gamepad_layout * layout, uint8_t * report,
+	uint32_t buttons, const uint8_t * axes, const uint8_t * native_bits){
+	gamepad_report_clear(layout, report);
+	gamepad_report_set_buttons(layout, report, buttons);
+	for (int i = 0; i < layout->axes; i++){
+		gamepad_report_set_axis(layout, report, i, axes[i], native_bits[i]);
+	}
+}
+
+static const uint8_t guitar_bits[] = {6, 6, 5};
+
+static void test_layout(void){
+	zassert_equal(layout_aligned.size, 5 + STAMP, NULL);
+	zassert_equal(layout_aligned.axis[0].offset, 16, NULL);
+	zassert_equal(layout_aligned.axis[2].offset, 32, NULL);
+	zassert_equal(layout_aligned.axis[2].width, 8, NULL);
+	zassert_equal(layout_aligned.axis[2].bits, 5, NULL);
+	zassert_equal(layout_packed.axis[1].offset, 16, NULL);
+	zassert_equal(layout_packed.axis[2].offset, 22, NULL);
+	zassert_equal(layout_packed.axis[2].width, 5, NULL);
+	zassert_equal(layout_even.axes, 1, NULL);
+	zassert_equal(layout_even.axis[0].offset, 8, NULL);
+}
+
+static void test_pack_aligned(void){
+	/* Bits beyond the declared widths must not leak into the report */
+	const uint8_t axes[] = {0xff, 0xff, 0xff};
+	const uint8_t expected[] = {0xff, 0x03, 0x3f, 0x3f, 0x1f};
+	uint8_t buf[GAMEPAD_REPORT_SIZE(ALIGNED)];
+	/* Stale data from a previous report must be cleared */
+	memset(buf, 0xa5, sizeof(buf));
+	fill_report(&layout_aligned, buf, UINT32_MAX, axes, guitar_bits);
+	zassert_mem_equal(buf, expected, sizeof(expected), "unexpected byte aligned report");
+}
+
+static void test_pack_packed(void){
+	const uint8_t axes[] = {0x15, 0x2a, 0x11};
+	const uint8_t expected[] = {0xa5, 0x56, 0x6a, 0x04};
+	uint8_t buf[GAMEPAD_REPORT_SIZE(PACKED)];
+	fill_report(&layout_packed, buf, 0x2a5, axes, guitar_bits);
+	zassert_mem_equal(buf, expected, sizeof(expected), "unexpected bit packed report");
+}
+
+static void test_pack_even(void){
+	/* A 5 bit whammy reported on an 8 bit axis is scaled up */
+	const uint8_t axes[] = {0x10};
+	const uint8_t native_bits[] = {5};
+	const uint8_t expected[] = {0xa5, 0x84};
+	uint8_t buf[GAMEPAD_REPORT_SIZE(EVEN)];
+	fill_report(&layout_even, buf, 0x1a5, axes, native_bits);
+	zassert_mem_equal(buf, expected, sizeof(expected), "unexpected report");
+}
+
+static void test_scale_full(void){
+	/* Both ends of the control reach both ends of the axis */
+	const uint8_t native_bits[] = {5, 6, 3, 1};
+	uint8_t buf[GAMEPAD_REPORT_SIZE(EVEN)];
+	for (int i = 0; i < ARRAY_SIZE(native_bits); i++){
+		const uint8_t low[] = {0};
+		const uint8_t high[] = {BIT_MASK(native_bits[i])};
+		fill_report(&layout_even, buf, 0, low, &native_bits[i]);
+		zassert_equal(buf[1], 0x00, "%d bits: the lowest value should be 0", native_bits[i]);
+		fill_report(&layout_even, buf, 0, high, &native_bits[i]);
+		zassert_equal(buf[1], 0xff, "%d bits: full scale should be 0xff", native_bits[i]);
+	}
+	/* Values in between keep their order: 3 bits go up in steps of 36 or 37 */
+	const uint8_t mid[] = {0x4};
+	const uint8_t three[] = {3};
+	fill_report(&layout_even, buf, 0, mid, three);
+	zassert_equal(buf[1], 0x92, "unexpected scaled value");
+}
+
+static void test_set_button(void){
+	uint8_t buf[GAMEPAD_REPORT_SIZE(ALIGNED)] = {0};
+	gamepad_report_set_button(&layout_aligned, buf, 9, true);
+	zassert_equal(buf[1], 0x02, "button 10 should be bit 1 of the second byte");
+	gamepad_report_set_button(&layout_aligned, buf, 9, false);
+	zassert_equal(buf[1], 0x00, "button 10 should be cleared");
+	/* Buttons the layout has no room for are ignored */
+	gamepad_report_set_button(&layout_aligned, buf, 10, true);
+	zassert_equal(buf[1], 0x00, "button 11 does not exist");
+}
+
+static void test_descriptor_padding(void){
+	/* Nothing to pad: both padding slots collapse into Push / Pop pairs */
+	int push = 0;
+	for (int i = 0; i < sizeof(desc_even) - 1; i++){
+		if (desc_even[i] == HID_ITEM_PUSH && desc_even[i + 1] == HID_ITEM_POP){
+			push++;
+		}
+	}
+	zassert_equal(push, 6, "expected two empty padding slots");
+	/* Both layouts describe the same items, so the length never changes */
+	zassert_equal(sizeof(desc_aligned), sizeof(desc_even) +
+		(GAMEPAD_AXES(ALIGNED) - GAMEPAD_AXES(EVEN)) * 11, "unexpected descriptor length");
+}
+
+#ifdef CONFIG_SHREDLINK_REPORT_TIMESTAMP
+static void test_stamp(void){
+	const uint8_t axes[] = {0xff, 0xff, 0xff};
+	const uint8_t expected[] = {0xff, 0x03, 0x3f, 0x3f, 0x1f,
+		0x78, 0x56, 0x34, 0x12, 0xcd, 0xab};
+	uint8_t buf[GAMEPAD_REPORT_SIZE(ALIGNED)];
+	zassert_equal(sizeof(buf), sizeof(expected), "the stamp should take 6 bytes");
+	memset(buf, 0xa5, sizeof(buf));
+	fill_report(&layout_aligned, buf, UINT32_MAX, axes, guitar_bits);
+	gamepad_report_set_stamp(&layout_aligned, buf, 0x12345678, 0xabcd);
+	zassert_mem_equal(buf, expected, sizeof(expected), "the stamp should follow the data");
+	/* The vendor usage page is declared once, after the tail padding */
+	int vendor = 0;
+	for (int i = 0; i < sizeof(desc_aligned) - 2; i++){
+		if (desc_aligned[i] == HID_ITEM_USAGE_PAGE16 && desc_aligned[i + 1] == 0x00 &&
+			desc_aligned[i + 2] == 0xff){
+			vendor++;
+		}
+	}
+	zassert_equal(vendor, 1, "expected a single vendor defined field");
+	zassert_equal(sizeof(desc_even), 53 + 22, "unexpected descriptor length");
+}
+#else
+static void test_stamp(void){
+	/* The layout of the report is left untouched */
+	zassert_equal(GAMEPAD_STAMP_SIZE, 0, NULL);
+	zassert_equal(sizeof(desc_even), 53, "unexpected descriptor length");
+}
+#endif
+
+void test_main(void)
+{
+	ztest_test_suite(hid_report_tests,
+		ztest_unit_test(test_report_size),
+		ztest_unit_test(test_layout),
+		ztest_unit_test(test_pack_aligned),
+		ztest_unit_test(test_pack_packed),
+		ztest_unit_test(test_pack_even),
+		ztest_unit_test(test_scale_full),
+		ztest_unit_test(test_set_button),
+		ztest_unit_test(test_descriptor_padding),
+		ztest_unit_test(test_stamp)
+	);
+	ztest_run_test_suite(hid_report_tests);
+}
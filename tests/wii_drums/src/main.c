@@ -0,0 +1,264 @@
+/**
+ * @file main.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include <string.h>
+#include <zephyr.h>
+#include <ztest.h>
+#include <drivers/gamepad.h>
+#include <wii.h>
+#include <wii_emul.h>
+
+#define ROUNDS	64
+/* Reads needed to report a full queue of hits, released in between */
+#define MAX_READS	(3 * CONFIG_WII_EMUL_DRUM_QUEUE)
+
+static const struct device *drums = DEVICE_DT_GET(DT_NODELABEL(wii_drums));
+static const struct emul *emul;
+
+/* Pads, plus and minus, then the stick and the velocity of each pad */
+static const struct gamepad_layout layout = {
+	.size = 10,
+	.buttons = 8,
+	.axes = 8,
+	.axis = {{8, 8, 6}, {16, 8, 6},
+		{24, 8, 3}, {32, 8, 3}, {40, 8, 3}, {48, 8, 3}, {56, 8, 3}, {64, 8, 3}},
+};
+
+static uint8_t report[10];
+
+static uint8_t velocity(enum wii_drum_pad pad){
+	return report[3 + pad];
+}
+
+/**
+ * @brief Wait until every hit was held long enough, and check that the
+ * next read releases the pads.
+ *
+ */
+static void release(void){
+	uint32_t changed;
+	k_usleep(2 * CONFIG_WII_HIT_HOLD_US);
+	zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+	zassert_equal(report[0] & BIT_MASK(WII_DRUM_PADS), 0, "pads should be released");
+}
+
+/**
+ * @brief Press edges of each pad over several reads, with the velocity
+ * reported along with each press
+ *
+ */
+struct pad_edges {
+	int count[WII_DRUM_PADS];
+	uint8_t velocity[WII_DRUM_PADS][CONFIG_WII_EMUL_DRUM_QUEUE];
+};
+
+static void read_edges(struct pad_edges * edges){
+	uint32_t changed;
+	uint8_t last = report[0] & BIT_MASK(WII_DRUM_PADS);
+	memset(edges, 0, sizeof(*edges));
+	for (int n = 0; n < MAX_READS; n++){
+		zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+		uint8_t pads = report[0] & BIT_MASK(WII_DRUM_PADS);
+		for (int pad = 0; pad < WII_DRUM_PADS; pad++){
+			if ((pads & ~last) & BIT(pad)){
+				zassert_true(edges->count[pad] < CONFIG_WII_EMUL_DRUM_QUEUE, "pad %d", pad);
+				edges->velocity[pad][edges->count[pad]++] = velocity(pad);
+			}
+		}
+		last = pads;
+	}
+}
+
+static void test_attach(void){
+	uint32_t changed;
+	emul = emul_get_binding(DT_LABEL(DT_NODELABEL(wii_drums)));
+	zassert_not_null(emul, "no emulator");
+	zassert_true(device_is_ready(drums), "wii peripheral not ready");
+	zassert_ok(wii_emul_set_type(emul, WII_EMUL_DRUMS), NULL);
+	zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+	zassert_equal(changed, GAMEPAD_CHANGED_ALL, "first read reports everything");
+	zassert_equal(report[0], 0, "nothing pressed");
+	/* Stick centered */
+	zassert_equal(report[1], 0x20, NULL);
+	zassert_equal(report[2], 0x20, NULL);
+}
+
+static void test_hit(void){
+	uint32_t changed;
+	zassert_ok(wii_emul_drum_hit(emul, WII_DRUM_RED, 5), NULL);
+	zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+	zassert_equal(report[0], BIT(WII_DRUM_RED), NULL);
+	zassert_equal(velocity(WII_DRUM_RED), 5, NULL);
+	zassert_true(changed & GAMEPAD_CHANGED_BUTTONS, NULL);
+	zassert_true(changed & GAMEPAD_CHANGED_AXIS(2 + WII_DRUM_RED), NULL);
+	/* The hit is over on the kit, but is held for the host */
+	zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+	zassert_equal(report[0], BIT(WII_DRUM_RED), "hit should be held");
+	zassert_equal(changed, 0, NULL);
+	release();
+	/* The velocity of the last hit stays */
+	zassert_equal(velocity(WII_DRUM_RED), 5, NULL);
+}
+
+/**
+ * @brief A full queue of hits, across every pad, is reported by a single
+ * read up to the first pad hit twice
+ *
+ */
+static void test_burst(void){
+	uint32_t changed;
+	struct pad_edges edges;
+	for (int i = 0; i < CONFIG_WII_EMUL_DRUM_QUEUE; i++){
+		zassert_ok(wii_emul_drum_hit(emul, i % WII_DRUM_PADS, i % 8), NULL);
+	}
+	zassert_equal(wii_emul_drum_hit(emul, WII_DRUM_BASS, 7), -ENOSPC, "queue should be full");
+	zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+	zassert_equal(report[0], BIT_MASK(WII_DRUM_PADS), "every pad was hit");
+	for (int pad = 0; pad < WII_DRUM_PADS; pad++){
+		zassert_equal(velocity(pad), pad, "pad %d", pad);
+	}
+	/* The second hits of the first pads follow, each as a press of its own */
+	read_edges(&edges);
+	zassert_equal(wii_emul_drum_pending(emul), 0, "the queue should be drained");
+	for (int pad = 0; pad < WII_DRUM_PADS; pad++){
+		int expected = 0;
+		for (int i = WII_DRUM_PADS; i < CONFIG_WII_EMUL_DRUM_QUEUE; i++){
+			if (i % WII_DRUM_PADS == pad){
+				zassert_true(expected < edges.count[pad], "pad %d: hit %d lost", pad, i);
+				zassert_equal(edges.velocity[pad][expected], i % 8, "pad %d", pad);
+				expected++;
+			}
+		}
+		zassert_equal(edges.count[pad], expected, "pad %d", pad);
+	}
+	release();
+}
+
+/**
+ * @brief Hits of a single pad, queued or closer than the hold time, are
+ * each reported as a press, with a release in between
+ *
+ */
+static void test_repeat(void){
+	uint32_t changed;
+	struct pad_edges edges;
+	for (int i = 0; i < 4; i++){
+		zassert_ok(wii_emul_drum_hit(emul, WII_DRUM_YELLOW, i), NULL);
+	}
+	read_edges(&edges);
+	zassert_equal(edges.count[WII_DRUM_YELLOW], 4, "queued hits were merged");
+	for (int i = 0; i < 4; i++){
+		zassert_equal(edges.velocity[WII_DRUM_YELLOW][i], i, "hit %d", i);
+	}
+	release();
+
+	zassert_ok(wii_emul_drum_hit(emul, WII_DRUM_BLUE, 3), NULL);
+	zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+	zassert_equal(report[0], BIT(WII_DRUM_BLUE), NULL);
+	/* Hit again while the first hit is still held */
+	zassert_ok(wii_emul_drum_hit(emul, WII_DRUM_BLUE, 6), NULL);
+	zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+	zassert_equal(report[0], 0, "the pad should be released first");
+	zassert_true(changed & GAMEPAD_CHANGED_BUTTONS, NULL);
+	zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+	zassert_equal(report[0], BIT(WII_DRUM_BLUE), "the second hit should be pressed");
+	zassert_equal(velocity(WII_DRUM_BLUE), 6, NULL);
+	release();
+}
+
+/**
+ * @brief Rolls of growing length between reads: every hit reaches the report
+ *
+ */
+static void test_roll(void){
+	uint32_t changed;
+	int hits = 0;
+	int seen = 0;
+	for (int r = 0; r < ROUNDS; r++){
+		int count = 1 + r % WII_DRUM_PADS;
+		uint32_t expected = 0;
+		for (int i = 0; i < count; i++){
+			enum wii_drum_pad pad = (r + i) % WII_DRUM_PADS;
+			zassert_ok(wii_emul_drum_hit(emul, pad, (r + i) % 8), NULL);
+			expected |= BIT(pad);
+			hits++;
+		}
+		zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+		zassert_equal(report[0] & BIT_MASK(WII_DRUM_PADS), expected, "round %d", r);
+		for (int i = 0; i < count; i++){
+			enum wii_drum_pad pad = (r + i) % WII_DRUM_PADS;
+			zassert_equal(velocity(pad), (r + i) % 8, "round %d pad %d", r, pad);
+		}
+		seen += popcount(expected);
+		release();
+	}
+	zassert_equal(seen, hits, "hits were lost");
+}
+
+/**
+ * @brief Buttons and the stick are sent along with every hit
+ *
+ */
+static void test_buttons(void){
+	uint32_t changed;
+	/* Stick pushed, plus pressed and the bass pedal held down */
+	const struct wii_btn_data frame = {
+		.raw = {0x3f, 0x00, 0xff, 0xff, 0xfb, 0xfb}
+	};
+	zassert_ok(wii_emul_set_frame(emul, &frame), NULL);
+	zassert_ok(wii_emul_drum_hit(emul, WII_DRUM_GREEN, 7), NULL);
+	zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+	zassert_equal(report[0], BIT(WII_DRUM_GREEN) | BIT(WII_DRUM_BASS) | BIT(WII_DRUM_PADS), NULL);
+	zassert_equal(report[1], 0x3f, NULL);
+	zassert_equal(report[2], 0x00, NULL);
+	zassert_ok(wii_emul_set_type(emul, WII_EMUL_DRUMS), NULL);
+	release();
+	zassert_equal(report[0], 0, NULL);
+}
+
+/**
+ * @brief Hits queued while the kit is discovered are not lost to the
+ * frames read to probe for single transaction fetches
+ *
+ */
+static void test_discovery(void){
+	uint32_t changed;
+	zassert_ok(wii_emul_set_connected(emul, false), NULL);
+	zassert_not_equal(gamepad_read(drums, &layout, report, &changed), 0,
+		"read should fail while unplugged");
+	for (int pad = 0; pad < WII_DRUM_PADS; pad++){
+		zassert_ok(wii_emul_drum_hit(emul, pad, pad), NULL);
+	}
+	zassert_ok(wii_emul_set_connected(emul, true), NULL);
+	zassert_ok(gamepad_read(drums, &layout, report, &changed), NULL);
+	zassert_equal(wii_emul_drum_pending(emul), 0, "the queue should be drained");
+	zassert_equal(report[0] & BIT_MASK(WII_DRUM_PADS), BIT_MASK(WII_DRUM_PADS),
+		"hits queued at discovery were lost");
+	for (int pad = 0; pad < WII_DRUM_PADS; pad++){
+		zassert_equal(velocity(pad), pad, "pad %d", pad);
+	}
+	release();
+}
+
+void test_main(void)
+{
+	ztest_test_suite(wii_drums,
+			 ztest_unit_test(test_attach),
+			 ztest_unit_test(test_hit),
+			 ztest_unit_test(test_burst),
+			 ztest_unit_test(test_repeat),
+			 ztest_unit_test(test_roll),
+			 ztest_unit_test(test_buttons),
+			 ztest_unit_test(test_discovery)
+			 );
+
+	ztest_run_test_suite(wii_drums);
+}
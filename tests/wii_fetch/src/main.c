@@ -0,0 +1,172 @@
+/**
+ * @file main.c
+ * @author Brian Bradley (brian.bradley.p@gmail.com)
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2026 Brian Bradley
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include <string.h>
+#include <zephyr.h>
+#include <ztest.h>
+#include <wii.h>
+#include <wii_emul.h>
+
+#define FRAMES	16
+
+/* Official peripherals need about this long to have data ready */
+#define OFFICIAL_DATA_READY_US	150
+
+static const struct device *wii = DEVICE_DT_GET(DT_NODELABEL(wii_guitar));
+static const struct emul *emul;
+
+static const struct wii_btn_data strum = {
+	.raw = {0x20, 0x20, 0x00, 0x10, 0xbf, 0xfe}
+};
+
+/**
+ * @brief Fetch FRAMES frames, checking every one, and return the bus activity
+ *
+ */
+static void fetch_frames(struct wii_emul_stats * stats){
+	struct wii_btn_data frame;
+	zassert_ok(wii_emul_set_frame(emul, &strum), NULL);
+	wii_emul_reset_stats(emul);
+	for (int i = 0; i < FRAMES; i++){
+		zassert_ok(wii_peripheral_fetch(wii, &frame), NULL);
+		zassert_mem_equal(frame.raw, strum.raw, sizeof(frame.raw), "frame %d", i);
+	}
+	wii_emul_get_stats(emul, stats);
+}
+
+/**
+ * @brief Unplug the peripheral, so that the next fetch discovers it again
+ *
+ */
+static void reattach(void){
+	struct wii_btn_data frame;
+	wii_emul_set_connected(emul, false);
+	zassert_not_equal(wii_peripheral_fetch(wii, &frame), 0, "fetch should fail while unplugged");
+	wii_emul_set_connected(emul, true);
+	zassert_ok(wii_peripheral_fetch(wii, &frame), NULL);
+}
+
+static void test_single_transaction(void){
+	struct wii_emul_stats stats;
+	emul = emul_get_binding(DT_LABEL(DT_NODELABEL(wii_guitar)));
+	zassert_not_null(emul, "no emulator");
+	zassert_true(device_is_ready(wii), "wii peripheral not ready");
+	zassert_ok(wii_emul_set_data_ready(emul, 0), NULL);
+	reattach();
+	fetch_frames(&stats);
+	zassert_equal(stats.transactions, FRAMES, "expected one transaction per frame");
+	zassert_equal(stats.not_ready, 0, NULL);
+}
+
+/**
+ * @brief A peripheral which stops keeping up is caught by the first
+ * invalid frame, which is fetched again with a delay
+ *
+ */
+static void test_fallback(void){
+	struct wii_emul_stats stats;
+	struct wii_btn_data frame;
+	zassert_ok(wii_emul_set_frame(emul, &strum), NULL);
+	zassert_ok(wii_emul_set_data_ready(emul, OFFICIAL_DATA_READY_US), NULL);
+	wii_emul_reset_stats(emul);
+	zassert_ok(wii_peripheral_fetch(wii, &frame), NULL);
+	zassert_mem_equal(frame.raw, strum.raw, sizeof(frame.raw), "invalid frame returned");
+	wii_emul_get_stats(emul, &stats);
+	zassert_equal(stats.not_ready, 1, NULL);
+	zassert_equal(stats.transactions, 3, "expected the single transaction, then two");
+	fetch_frames(&stats);
+	zassert_equal(stats.transactions, 2 * FRAMES, "expected the delayed fetch from now on");
+	zassert_equal(stats.not_ready, 0, NULL);
+}
+
+/**
+ * @brief The mode is chosen again whenever the peripheral is discovered
+ *
+ */
+static void test_probe(void){
+	struct wii_emul_stats stats;
+	zassert_ok(wii_emul_set_data_ready(emul, OFFICIAL_DATA_READY_US), NULL);
+	reattach();
+	fetch_frames(&stats);
+	zassert_equal(stats.transactions, 2 * FRAMES, "official peripherals need the delay");
+	zassert_equal(stats.not_ready, 0, NULL);
+
+	zassert_ok(wii_emul_set_data_ready(emul, 0), NULL);
+	reattach();
+	fetch_frames(&stats);
+	zassert_equal(stats.transactions, FRAMES, NULL);
+}
+
+/**
+ * @brief The single transaction saves a stop, a start and an address
+ * byte on the wire, beside the delay
+ *
+ */
+static void test_bus_time(void){
+	struct wii_emul_stats single;
+	struct wii_emul_stats delayed;
+	zassert_ok(wii_emul_set_data_ready(emul, 0), NULL);
+	reattach();
+	fetch_frames(&single);
+	zassert_ok(wii_emul_set_data_ready(emul, OFFICIAL_DATA_READY_US), NULL);
+	reattach();
+	fetch_frames(&delayed);
+	TC_PRINT("fetch time per frame: single transaction %u ns on the wire + %u ns wait, "
+		"delayed %u ns on the wire + %u ns wait\n",
+		(uint32_t)(single.bus_ns / FRAMES), (uint32_t)(single.wait_ns / FRAMES),
+		(uint32_t)(delayed.bus_ns / FRAMES), (uint32_t)(delayed.wait_ns / FRAMES));
+	zassert_equal(single.bytes, delayed.bytes, "the same bytes should be sent");
+	zassert_true(single.bus_ns < delayed.bus_ns, NULL);
+	/* The delayed fetch waits for the data, the single transaction does not */
+	zassert_true(delayed.wait_ns >= (uint64_t)FRAMES * OFFICIAL_DATA_READY_US * NSEC_PER_USEC, NULL);
+	zassert_true(single.wait_ns < delayed.wait_ns, NULL);
+}
+
+/**
+ * @brief A batch reads every frame in turn, a failed one does not stop it
+ *
+ */
+static void test_batch(void){
+	const struct device *devs[] = {wii, wii, wii, wii};
+	struct wii_frame frames[ARRAY_SIZE(devs)];
+	zassert_ok(wii_emul_set_data_ready(emul, 0), NULL);
+	reattach();
+	zassert_ok(wii_emul_set_frame(emul, &strum), NULL);
+	zassert_equal(wii_peripheral_fetch_batch(devs, frames, ARRAY_SIZE(frames)),
+		ARRAY_SIZE(frames), "every frame should be fetched");
+	for (int i = 0; i < ARRAY_SIZE(frames); i++){
+		zassert_ok(frames[i].err, "frame %d", i);
+		zassert_mem_equal(frames[i].data.raw, strum.raw, sizeof(strum.raw), "frame %d", i);
+		if (i > 0){
+			zassert_true(frames[i].cycles - frames[i - 1].cycles < UINT32_MAX / 2,
+				"frames should be stamped in order");
+		}
+	}
+	wii_emul_set_connected(emul, false);
+	zassert_equal(wii_peripheral_fetch_batch(devs, frames, ARRAY_SIZE(frames)), 0, NULL);
+	for (int i = 0; i < ARRAY_SIZE(frames); i++){
+		zassert_not_equal(frames[i].err, 0, "frame %d should fail while unplugged", i);
+	}
+	wii_emul_set_connected(emul, true);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(wii_fetch,
+			 ztest_unit_test(test_single_transaction),
+			 ztest_unit_test(test_fallback),
+			 ztest_unit_test(test_probe),
+			 ztest_unit_test(test_bus_time),
+			 ztest_unit_test(test_batch)
+			 );
+
+	ztest_run_test_suite(wii_fetch);
+}